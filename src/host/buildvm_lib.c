@@ -195,18 +195,26 @@ static void libdef_lua(BuildCtx *ctx, char *p, int arg)
       if (!strcmp(libbc_map[i].name, p)) {
 	int ofs = libbc_map[i].ofs;
 	int len = libbc_map[i+1].ofs - ofs;
-	obuf[2]++;  /* Bump hash table size. */
 	*optr++ = LIBINIT_LUA;
-	libdef_name(p, 0);
+	if (regfunc != REGFUNC_NOREGUV) {
+	  obuf[2]++;  /* Bump hash table size. */
+	  libdef_name(p, 0);
+	} else {  /* Name it after the function using it, for debug info. */
+	  char *q = strchr(p+modnamelen+1, '_');
+	  if (q) *q = '\0';
+	  libdef_name(p, LIBINIT_NOREG);
+	}
 	memcpy(optr, libbc_code + ofs, len);
 	libdef_fixupbc(optr);
 	optr += len;
+	regfunc = REGFUNC_OK;
 	return;
       }
     }
     fprintf(stderr, "Error: missing libbc definition for %s\n", p);
     exit(1);
   }
+  regfunc = REGFUNC_OK;
 }
 
 static uint32_t find_rec(char *name)
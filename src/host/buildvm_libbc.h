@@ -25,14 +25,60 @@ BC_ISGT,3,1,0,BC_JMP,3,14,128,BC_ISGT,1,2,0,BC_JMP,3,12,128,BC_TGETR,3,1,0,
 BC_ADDVN,4,1,1,BC_MOV,5,2,0,BC_KSHORT,6,1,0,BC_FORI,4,4,128,BC_SUBVN,8,1,7,
 BC_TGETR,9,7,0,BC_TSETR,9,8,0,BC_FORL,4,252,127,BC_KPRI,4,0,0,BC_TSETR,4,2,0,
 BC_RET1,3,2,0,BC_RET0,0,1,0,0,2,
-/* table.move */ 0,5,12,0,0,0,35,BC_ISTYPE,0,12,0,BC_ISTYPE,1,14,0,BC_ISTYPE,
-2,14,0,BC_ISTYPE,3,14,0,BC_ISNEP,4,0,0,BC_JMP,5,1,128,BC_MOV,4,0,0,BC_ISTYPE,
-4,12,0,BC_ISGT,1,2,0,BC_JMP,5,24,128,BC_SUBVV,5,1,3,BC_ISLT,2,3,0,BC_JMP,6,4,
-128,BC_ISLE,3,1,0,BC_JMP,6,2,128,BC_ISEQV,4,0,0,BC_JMP,6,9,128,BC_MOV,6,1,0,
-BC_MOV,7,2,0,BC_KSHORT,8,1,0,BC_FORI,6,4,128,BC_ADDVV,10,5,9,BC_TGETR,11,9,0,
-BC_TSETR,11,10,4,BC_FORL,6,252,127,BC_JMP,6,8,128,BC_MOV,6,2,0,BC_MOV,7,1,0,
-BC_KSHORT,8,255,255,BC_FORI,6,4,128,BC_ADDVV,10,5,9,BC_TGETR,11,9,0,BC_TSETR,
-11,10,4,BC_FORL,6,252,127,BC_RET1,4,2,0,
+/* table.sort.lt */ 0,2,3,0,0,0,6,BC_ISLT,0,1,0,BC_JMP,2,2,128,BC_KPRI,2,1,0,
+BC_JMP,3,1,128,BC_KPRI,2,2,0,BC_RET1,2,2,0,
+/* table.sort.aux */ 0,3,19,0,0,6,241,1,BC_ISTYPE,0,12,0,BC_TNEW,3,0,0,
+BC_KSHORT,4,0,0,BC_KSHORT,5,1,0,BC_MOV,6,1,0,BC_KSHORT,7,0,0,BC_MOV,8,1,0,
+BC_KSHORT,9,1,0,BC_ISGE,9,8,0,BC_JMP,9,4,128,BC_LOOP,9,3,128,BC_ADDVN,7,0,7,
+BC_MULVN,8,1,8,BC_JMP,9,249,127,BC_LOOP,9,225,128,BC_SUBVV,9,5,6,BC_KSHORT,10,
+12,0,BC_ISGE,9,10,0,BC_JMP,9,36,128,BC_ADDVN,9,2,5,BC_MOV,10,6,0,BC_KSHORT,11,
+1,0,BC_FORI,9,19,128,BC_TGETR,13,12,0,BC_SUBVN,14,2,12,BC_ISGT,5,14,0,BC_JMP,
+15,12,128,BC_MOV,15,2,0,BC_MOV,17,13,0,BC_TGETR,18,14,0,BC_CALL,15,3,2,BC_ISF,
+0,15,0,BC_JMP,16,6,128,BC_LOOP,15,5,128,BC_ADDVN,15,2,14,BC_TGETR,16,14,0,
+BC_TSETR,16,15,0,BC_SUBVN,14,2,14,BC_JMP,15,242,127,BC_ADDVN,15,2,14,BC_TSETR,
+13,15,0,BC_FORL,9,237,127,BC_ISNEN,4,3,0,BC_JMP,9,2,128,BC_KPRI,9,1,0,BC_RET1,
+9,2,0,BC_SUBVN,9,0,4,BC_TGETV,9,9,3,BC_SUBVN,10,2,4,BC_TGETV,10,10,3,BC_TGETV,
+7,4,3,BC_MOV,6,10,0,BC_MOV,5,9,0,BC_SUBVN,4,4,4,BC_JMP,9,215,127,BC_ISNEN,7,3,
+0,BC_JMP,9,68,128,BC_SUBVV,9,5,6,BC_ADDVN,9,2,9,BC_ADDVN,10,2,9,BC_LOOP,11,62,
+128,BC_KPRI,11,0,0,BC_KSHORT,12,1,0,BC_ISGE,12,10,0,BC_JMP,12,3,128,BC_SUBVN,
+10,2,10,BC_MOV,11,10,0,BC_JMP,12,14,128,BC_KSHORT,12,1,0,BC_ISGT,9,12,0,
+BC_JMP,12,1,128,BC_JMP,11,51,128,BC_ADDVV,12,9,5,BC_SUBVN,12,2,12,BC_ADDVV,13,
+9,5,BC_SUBVN,13,2,13,BC_TGETR,13,13,0,BC_TGETR,14,5,0,BC_TSETR,14,12,0,
+BC_TSETR,13,5,0,BC_SUBVN,9,2,9,BC_KSHORT,11,1,0,BC_ADDVV,12,11,5,BC_SUBVN,12,
+2,12,BC_TGETR,12,12,0,BC_LOOP,13,33,128,BC_MULVN,13,0,11,BC_ISGE,9,13,0,
+BC_JMP,14,1,128,BC_JMP,13,29,128,BC_ISGE,13,9,0,BC_JMP,14,10,128,BC_MOV,14,2,
+0,BC_ADDVV,16,13,5,BC_SUBVN,16,2,16,BC_TGETR,16,16,0,BC_ADDVV,17,13,5,
+BC_TGETR,17,17,0,BC_CALL,14,3,2,BC_ISF,0,14,0,BC_JMP,15,1,128,BC_ADDVN,13,2,
+13,BC_MOV,14,2,0,BC_MOV,16,12,0,BC_ADDVV,17,13,5,BC_SUBVN,17,2,17,BC_TGETR,17,
+17,0,BC_CALL,14,3,2,BC_IST,0,14,0,BC_JMP,14,1,128,BC_JMP,13,8,128,BC_ADDVV,14,
+11,5,BC_SUBVN,14,2,14,BC_ADDVV,15,13,5,BC_SUBVN,15,2,15,BC_TGETR,15,15,0,
+BC_TSETR,15,14,0,BC_MOV,11,13,0,BC_JMP,13,222,127,BC_ADDVV,13,11,5,BC_SUBVN,
+13,2,13,BC_TSETR,12,13,0,BC_JMP,11,193,127,BC_MOV,6,5,0,BC_JMP,9,145,127,
+BC_KSHORT,9,1,0,BC_MULVN,10,5,9,BC_SUBVV,11,5,6,BC_ISGT,10,11,0,BC_JMP,10,3,
+128,BC_LOOP,10,2,128,BC_MULVN,9,0,9,BC_JMP,10,249,127,BC_ADDVV,9,9,5,BC_TGETR,
+10,5,0,BC_TGETR,11,9,0,BC_TGETR,12,6,0,BC_SUBVN,7,2,7,BC_MOV,13,2,0,BC_MOV,15,
+11,0,BC_MOV,16,10,0,BC_CALL,13,3,2,BC_ISF,0,13,0,BC_JMP,14,3,128,BC_MOV,13,11,
+0,BC_MOV,11,10,0,BC_MOV,10,13,0,BC_MOV,13,2,0,BC_MOV,15,12,0,BC_MOV,16,11,0,
+BC_CALL,13,3,2,BC_ISF,0,13,0,BC_JMP,14,12,128,BC_MOV,13,12,0,BC_MOV,12,11,0,
+BC_MOV,11,13,0,BC_MOV,13,2,0,BC_MOV,15,11,0,BC_MOV,16,10,0,BC_CALL,13,3,2,
+BC_ISF,0,13,0,BC_JMP,14,3,128,BC_MOV,13,11,0,BC_MOV,11,10,0,BC_MOV,10,13,0,
+BC_MOV,13,10,0,BC_SUBVN,14,2,6,BC_TGETR,14,14,0,BC_TSETR,12,6,0,BC_TSETR,14,9,
+0,BC_TSETR,13,5,0,BC_SUBVN,13,2,6,BC_TSETR,11,13,0,BC_MOV,13,5,0,BC_SUBVN,14,
+2,6,BC_LOOP,15,37,128,BC_ADDVN,13,2,13,BC_MOV,15,2,0,BC_TGETR,17,13,0,BC_MOV,
+18,11,0,BC_CALL,15,3,2,BC_ISF,0,15,0,BC_JMP,16,8,128,BC_LOOP,15,7,128,
+BC_SUBVN,15,2,6,BC_ISGT,15,13,0,BC_JMP,15,2,128,BC_KPRI,15,2,0,BC_RET1,15,2,0,
+BC_ADDVN,13,2,13,BC_JMP,15,242,127,BC_SUBVN,14,2,14,BC_MOV,15,2,0,BC_MOV,17,
+11,0,BC_TGETR,18,14,0,BC_CALL,15,3,2,BC_ISF,0,15,0,BC_JMP,16,7,128,BC_LOOP,15,
+6,128,BC_ISGT,14,5,0,BC_JMP,15,2,128,BC_KPRI,15,2,0,BC_RET1,15,2,0,BC_SUBVN,
+14,2,14,BC_JMP,15,243,127,BC_ISGE,14,13,0,BC_JMP,15,1,128,BC_JMP,15,5,128,
+BC_TGETR,15,14,0,BC_TGETR,16,13,0,BC_TSETR,16,14,0,BC_TSETR,15,13,0,BC_JMP,15,
+218,127,BC_SUBVN,15,2,6,BC_TGETR,16,13,0,BC_TSETR,11,13,0,BC_TSETR,16,15,0,
+BC_ADDVN,4,4,4,BC_SUBVV,15,5,13,BC_SUBVV,16,13,6,BC_ISGE,15,16,0,BC_JMP,15,9,
+128,BC_SUBVN,15,0,4,BC_SUBVN,16,2,4,BC_ADDVN,17,2,13,BC_MOV,18,6,0,BC_TSETV,7,
+4,3,BC_TSETV,18,16,3,BC_TSETV,17,15,3,BC_SUBVN,6,2,13,BC_JMP,15,39,127,
+BC_SUBVN,15,0,4,BC_SUBVN,16,2,4,BC_MOV,17,5,0,BC_SUBVN,18,2,13,BC_TSETV,7,4,3,
+BC_TSETV,18,16,3,BC_TSETV,17,15,3,BC_ADDVN,5,2,13,BC_JMP,9,30,127,BC_RET0,0,1,
+0,4,1,128,128,128,255,3,2,0,6,8,
 #else
 /* math.deg */ 0,1,2,0,0,1,2,BC_MULVN,1,0,0,BC_RET1,1,2,0,241,135,158,166,3,
 220,203,178,130,4,
@@ -55,14 +101,60 @@ BC_ISGT,3,1,0,BC_JMP,3,14,128,BC_ISGT,1,2,0,BC_JMP,3,12,128,BC_TGETR,3,1,0,
 BC_ADDVN,4,1,1,BC_MOV,5,2,0,BC_KSHORT,6,1,0,BC_FORI,4,4,128,BC_SUBVN,8,1,7,
 BC_TGETR,9,7,0,BC_TSETR,9,8,0,BC_FORL,4,252,127,BC_KPRI,4,0,0,BC_TSETR,4,2,0,
 BC_RET1,3,2,0,BC_RET0,0,1,0,0,2,
-/* table.move */ 0,5,12,0,0,0,35,BC_ISTYPE,0,12,0,BC_ISTYPE,1,14,0,BC_ISTYPE,
-2,14,0,BC_ISTYPE,3,14,0,BC_ISNEP,4,0,0,BC_JMP,5,1,128,BC_MOV,4,0,0,BC_ISTYPE,
-4,12,0,BC_ISGT,1,2,0,BC_JMP,5,24,128,BC_SUBVV,5,1,3,BC_ISLT,2,3,0,BC_JMP,6,4,
-128,BC_ISLE,3,1,0,BC_JMP,6,2,128,BC_ISEQV,4,0,0,BC_JMP,6,9,128,BC_MOV,6,1,0,
-BC_MOV,7,2,0,BC_KSHORT,8,1,0,BC_FORI,6,4,128,BC_ADDVV,10,5,9,BC_TGETR,11,9,0,
-BC_TSETR,11,10,4,BC_FORL,6,252,127,BC_JMP,6,8,128,BC_MOV,6,2,0,BC_MOV,7,1,0,
-BC_KSHORT,8,255,255,BC_FORI,6,4,128,BC_ADDVV,10,5,9,BC_TGETR,11,9,0,BC_TSETR,
-11,10,4,BC_FORL,6,252,127,BC_RET1,4,2,0,
+/* table.sort.lt */ 0,2,3,0,0,0,6,BC_ISLT,0,1,0,BC_JMP,2,2,128,BC_KPRI,2,1,0,
+BC_JMP,3,1,128,BC_KPRI,2,2,0,BC_RET1,2,2,0,
+/* table.sort.aux */ 0,3,19,0,0,6,241,1,BC_ISTYPE,0,12,0,BC_TNEW,3,0,0,
+BC_KSHORT,4,0,0,BC_KSHORT,5,1,0,BC_MOV,6,1,0,BC_KSHORT,7,0,0,BC_MOV,8,1,0,
+BC_KSHORT,9,1,0,BC_ISGE,9,8,0,BC_JMP,9,4,128,BC_LOOP,9,3,128,BC_ADDVN,7,0,7,
+BC_MULVN,8,1,8,BC_JMP,9,249,127,BC_LOOP,9,225,128,BC_SUBVV,9,5,6,BC_KSHORT,10,
+12,0,BC_ISGE,9,10,0,BC_JMP,9,36,128,BC_ADDVN,9,2,5,BC_MOV,10,6,0,BC_KSHORT,11,
+1,0,BC_FORI,9,19,128,BC_TGETR,13,12,0,BC_SUBVN,14,2,12,BC_ISGT,5,14,0,BC_JMP,
+15,12,128,BC_MOV,15,2,0,BC_MOV,16,13,0,BC_TGETR,17,14,0,BC_CALL,15,3,2,BC_ISF,
+0,15,0,BC_JMP,16,6,128,BC_LOOP,15,5,128,BC_ADDVN,15,2,14,BC_TGETR,16,14,0,
+BC_TSETR,16,15,0,BC_SUBVN,14,2,14,BC_JMP,15,242,127,BC_ADDVN,15,2,14,BC_TSETR,
+13,15,0,BC_FORL,9,237,127,BC_ISNEN,4,3,0,BC_JMP,9,2,128,BC_KPRI,9,1,0,BC_RET1,
+9,2,0,BC_SUBVN,9,0,4,BC_TGETV,9,9,3,BC_SUBVN,10,2,4,BC_TGETV,10,10,3,BC_TGETV,
+7,4,3,BC_MOV,6,10,0,BC_MOV,5,9,0,BC_SUBVN,4,4,4,BC_JMP,9,215,127,BC_ISNEN,7,3,
+0,BC_JMP,9,68,128,BC_SUBVV,9,5,6,BC_ADDVN,9,2,9,BC_ADDVN,10,2,9,BC_LOOP,11,62,
+128,BC_KPRI,11,0,0,BC_KSHORT,12,1,0,BC_ISGE,12,10,0,BC_JMP,12,3,128,BC_SUBVN,
+10,2,10,BC_MOV,11,10,0,BC_JMP,12,14,128,BC_KSHORT,12,1,0,BC_ISGT,9,12,0,
+BC_JMP,12,1,128,BC_JMP,11,51,128,BC_ADDVV,12,9,5,BC_SUBVN,12,2,12,BC_ADDVV,13,
+9,5,BC_SUBVN,13,2,13,BC_TGETR,13,13,0,BC_TGETR,14,5,0,BC_TSETR,14,12,0,
+BC_TSETR,13,5,0,BC_SUBVN,9,2,9,BC_KSHORT,11,1,0,BC_ADDVV,12,11,5,BC_SUBVN,12,
+2,12,BC_TGETR,12,12,0,BC_LOOP,13,33,128,BC_MULVN,13,0,11,BC_ISGE,9,13,0,
+BC_JMP,14,1,128,BC_JMP,13,29,128,BC_ISGE,13,9,0,BC_JMP,14,10,128,BC_MOV,14,2,
+0,BC_ADDVV,15,13,5,BC_SUBVN,15,2,15,BC_TGETR,15,15,0,BC_ADDVV,16,13,5,
+BC_TGETR,16,16,0,BC_CALL,14,3,2,BC_ISF,0,14,0,BC_JMP,15,1,128,BC_ADDVN,13,2,
+13,BC_MOV,14,2,0,BC_MOV,15,12,0,BC_ADDVV,16,13,5,BC_SUBVN,16,2,16,BC_TGETR,16,
+16,0,BC_CALL,14,3,2,BC_IST,0,14,0,BC_JMP,14,1,128,BC_JMP,13,8,128,BC_ADDVV,14,
+11,5,BC_SUBVN,14,2,14,BC_ADDVV,15,13,5,BC_SUBVN,15,2,15,BC_TGETR,15,15,0,
+BC_TSETR,15,14,0,BC_MOV,11,13,0,BC_JMP,13,222,127,BC_ADDVV,13,11,5,BC_SUBVN,
+13,2,13,BC_TSETR,12,13,0,BC_JMP,11,193,127,BC_MOV,6,5,0,BC_JMP,9,145,127,
+BC_KSHORT,9,1,0,BC_MULVN,10,5,9,BC_SUBVV,11,5,6,BC_ISGT,10,11,0,BC_JMP,10,3,
+128,BC_LOOP,10,2,128,BC_MULVN,9,0,9,BC_JMP,10,249,127,BC_ADDVV,9,9,5,BC_TGETR,
+10,5,0,BC_TGETR,11,9,0,BC_TGETR,12,6,0,BC_SUBVN,7,2,7,BC_MOV,13,2,0,BC_MOV,14,
+11,0,BC_MOV,15,10,0,BC_CALL,13,3,2,BC_ISF,0,13,0,BC_JMP,14,3,128,BC_MOV,13,11,
+0,BC_MOV,11,10,0,BC_MOV,10,13,0,BC_MOV,13,2,0,BC_MOV,14,12,0,BC_MOV,15,11,0,
+BC_CALL,13,3,2,BC_ISF,0,13,0,BC_JMP,14,12,128,BC_MOV,13,12,0,BC_MOV,12,11,0,
+BC_MOV,11,13,0,BC_MOV,13,2,0,BC_MOV,14,11,0,BC_MOV,15,10,0,BC_CALL,13,3,2,
+BC_ISF,0,13,0,BC_JMP,14,3,128,BC_MOV,13,11,0,BC_MOV,11,10,0,BC_MOV,10,13,0,
+BC_MOV,13,10,0,BC_SUBVN,14,2,6,BC_TGETR,14,14,0,BC_TSETR,12,6,0,BC_TSETR,14,9,
+0,BC_TSETR,13,5,0,BC_SUBVN,13,2,6,BC_TSETR,11,13,0,BC_MOV,13,5,0,BC_SUBVN,14,
+2,6,BC_LOOP,15,37,128,BC_ADDVN,13,2,13,BC_MOV,15,2,0,BC_TGETR,16,13,0,BC_MOV,
+17,11,0,BC_CALL,15,3,2,BC_ISF,0,15,0,BC_JMP,16,8,128,BC_LOOP,15,7,128,
+BC_SUBVN,15,2,6,BC_ISGT,15,13,0,BC_JMP,15,2,128,BC_KPRI,15,2,0,BC_RET1,15,2,0,
+BC_ADDVN,13,2,13,BC_JMP,15,242,127,BC_SUBVN,14,2,14,BC_MOV,15,2,0,BC_MOV,16,
+11,0,BC_TGETR,17,14,0,BC_CALL,15,3,2,BC_ISF,0,15,0,BC_JMP,16,7,128,BC_LOOP,15,
+6,128,BC_ISGT,14,5,0,BC_JMP,15,2,128,BC_KPRI,15,2,0,BC_RET1,15,2,0,BC_SUBVN,
+14,2,14,BC_JMP,15,243,127,BC_ISGE,14,13,0,BC_JMP,15,1,128,BC_JMP,15,5,128,
+BC_TGETR,15,14,0,BC_TGETR,16,13,0,BC_TSETR,16,14,0,BC_TSETR,15,13,0,BC_JMP,15,
+218,127,BC_SUBVN,15,2,6,BC_TGETR,16,13,0,BC_TSETR,11,13,0,BC_TSETR,16,15,0,
+BC_ADDVN,4,4,4,BC_SUBVV,15,5,13,BC_SUBVV,16,13,6,BC_ISGE,15,16,0,BC_JMP,15,9,
+128,BC_SUBVN,15,0,4,BC_SUBVN,16,2,4,BC_ADDVN,17,2,13,BC_MOV,18,6,0,BC_TSETV,7,
+4,3,BC_TSETV,18,16,3,BC_TSETV,17,15,3,BC_SUBVN,6,2,13,BC_JMP,15,39,127,
+BC_SUBVN,15,0,4,BC_SUBVN,16,2,4,BC_MOV,17,5,0,BC_SUBVN,18,2,13,BC_TSETV,7,4,3,
+BC_TSETV,18,16,3,BC_TSETV,17,15,3,BC_ADDVN,5,2,13,BC_JMP,9,30,127,BC_RET0,0,1,
+0,4,1,128,128,128,255,3,2,0,6,8,
 #endif
 0
 };
@@ -75,7 +167,8 @@ static const struct { const char *name; int ofs; } libbc_map[] = {
 {"table_foreach",136},
 {"table_getn",213},
 {"table_remove",232},
-{"table_move",361},
-{NULL,508}
+{"table_sort_lt",361},
+{"table_sort_aux",392},
+{NULL,1375}
 };
 
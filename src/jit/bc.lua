@@ -73,6 +73,9 @@ local function bcline(func, pc, prefix)
   local s = format("%04d %s %-6s %3s ",
     pc, prefix or "  ", op, ma == 0 and "" or a)
   local d = shr(ins, 16)
+  if sub(op, 5) == "X " or op == "TSTML " then -- Lo-word is in the next NOP.
+    d = d*65536 + shr(funcbc(func, pc+1), 16)
+  end
   if mc == 13*128 then -- BCMjump
     return format("%s=> %04d\n", s, pc+d-0x7fff)
   end
@@ -83,19 +86,11 @@ local function bcline(func, pc, prefix)
   end
   local kc
   if mc == 10*128 then -- BCMstr
-    if op == "KSTRHI" then 
-      kc = funck(func, -(d*65536+shr(funcbc(func, pc-1), 16))-1)
-    else
-      kc = funck(func, -d-1)
-    end
+    kc = funck(func, -d-1)
     kc = format(#kc > 40 and '"%.40s"~' or '"%s"', gsub(kc, "%c", ctlsub))
   elseif mc == 9*128 then -- BCMnum
-    if op == "KNUMHI" then 
-      kc = funck(func, d*65536+shr(funcbc(func, pc-1), 16))
-    else
-      kc = funck(func, d)
-    end
-    if op == "TSETM " then kc = kc - 2^52 end
+    kc = funck(func, d)
+    if op == "TSETM " or op == "TSTML " then kc = kc - 2^52 end
   elseif mc == 12*128 then -- BCMfunc
     local fi = funcinfo(funck(func, -d-1))
     if fi.ffid then
@@ -29,6 +29,7 @@ Save LuaJIT bytecode: luajit -b[options] input output
   -l        Only list bytecode.
   -s        Strip debug info (default).
   -g        Keep debug info.
+  -i        Write an indexed dump, which is loaded lazily per function.
   -n name   Set module name (default: auto-detect from input name).
   -t type   Set output file type (default: auto-detect from output name).
   -a arch   Override architecture for object files (default: native).
@@ -624,7 +625,8 @@ end
 
 local function bcsave(ctx, input, output)
   local f = readfile(ctx, input)
-  local s = string.dump(f, ctx.strip)
+  local s = string.dump(f, ctx.index and (ctx.strip and "si" or "i") or
+			    ctx.strip)
   local t = ctx.type
   if not t then
     t = detecttype(output)
@@ -647,7 +649,7 @@ local function docmd(...)
   local n = 1
   local list = false
   local ctx = {
-    strip = true, arch = jit.arch, os = jit.os:lower(),
+    strip = true, index = false, arch = jit.arch, os = jit.os:lower(),
     type = false, modname = false,
   }
   while n <= #arg do
@@ -663,6 +665,8 @@ local function docmd(...)
 	  ctx.strip = true
 	elseif opt == "g" then
 	  ctx.strip = false
+	elseif opt == "i" then
+	  ctx.index = true
 	else
 	  if arg[n] == nil or m ~= #a then usage() end
 	  if opt == "e" then
@@ -83,6 +83,17 @@ LUALIB_API int (luaL_loadfilex) (lua_State *L, const char *filename,
 				 const char *mode);
 LUALIB_API int (luaL_loadbufferx) (lua_State *L, const char *buff, size_t sz,
 				   const char *name, const char *mode);
+LUALIB_API int (luaL_loadfilemap) (lua_State *L, const char *filename);
+LUALIB_API int (luaL_loadfilemapx) (lua_State *L, const char *filename,
+				    const char *mode);
+LUALIB_API int (luaL_loadbufferfrozen) (lua_State *L, const char *buff,
+				       size_t sz, const char *name);
+LUALIB_API int (luaL_loadfilefrozen) (lua_State *L, const char *filename);
+LUALIB_API int (luaL_loadfiles) (lua_State *L, const char *const *filenames,
+				 int n);
+LUALIB_API int (luaL_loadfilesx) (lua_State *L, const char *const *filenames,
+				  int n, int nthreads, const char *mode);
+LUALIB_API void (luaL_setloadcache) (lua_State *L, const char *dir);
 LUALIB_API void luaL_traceback (lua_State *L, lua_State *L1, const char *msg,
 				int level);
 LUALIB_API void (luaL_setfuncs) (lua_State *L, const luaL_Reg *l, int nup);
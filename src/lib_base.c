@@ -360,7 +360,7 @@ LJLIB_ASM_(xpcall)		LJLIB_REC(.)
 static int load_aux(lua_State *L, int status, int envarg)
 {
   if (status == LUA_OK) {
-    if (tvistab(L->base+envarg-1)) {
+    if (tvistab(L->base+envarg-1) && tvisfunc(L->top-1)) {  /* Not data. */
       GCfunc *fn = funcV(L->top-1);
       GCtab *t = tabV(L->base+envarg-1);
       setgcref(fn->c.env, obj2gco(t));
@@ -461,10 +461,17 @@ LJLIB_CF(gcinfo)
 LJLIB_CF(collectgarbage)
 {
   int opt = lj_lib_checkopt(L, 1, LUA_GCCOLLECT,  /* ORDER LUA_GC* */
-    "\4stop\7restart\7collect\5count\1\377\4step\10setpause\12setstepmul\1\377\11isrunning");
+    "\4stop\7restart\7collect\5count\1\377\4step\10setpause\12setstepmul\1\377\11isrunning\14setloadlimit\11loadstats");
   int32_t data = lj_lib_optint(L, 2, 0);
   if (opt == LUA_GCCOUNT) {
     setnumV(L->top, (lua_Number)G(L)->gc.total/1024.0);
+  } else if (opt == LUA_GCLOADSTATS) {
+    GCState *gc = &G(L)->gc;
+    setintV(L->top++, (int32_t)gc->loadnum);
+    setintV(L->top++, (int32_t)gc->loadstep);
+    setintV(L->top++, (int32_t)gc->loadcycle);
+    setnumV(L->top++, (lua_Number)gc->loadpeak/1024.0);
+    return 4;
   } else {
     int res = lua_gc(L, opt, data);
     if (opt == LUA_GCSTEP || opt == LUA_GCISRUNNING)
@@ -125,7 +125,7 @@ LJLIB_CF(buffer_method_put)		LJLIB_REC(.)
     } else if (tvisint(o)) {
       lj_strfmt_putint((SBuf *)sbx, intV(o));
     } else if (tvisnum(o)) {
-      lj_strfmt_putfnum((SBuf *)sbx, STRFMT_G14, numV(o));
+      lj_strfmt_putfnum((SBuf *)sbx, STRFMT_TOSTR(G(L)), numV(o));
     } else if (tvisbuf(o)) {
       SBufExt *sbx2 = bufV(o);
       if (sbx2 == sbx) lj_err_arg(L, (int)(arg+1), LJ_ERR_BUFFER_SELF);
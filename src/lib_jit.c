@@ -18,6 +18,7 @@
 #include "lj_tab.h"
 #include "lj_state.h"
 #include "lj_bc.h"
+#include "lj_bcdump.h"
 #if LJ_HASFFI
 #include "lj_ctype.h"
 #endif
@@ -256,6 +257,10 @@ LJLIB_CF(jit_util_funck)
   } else {
     if (~idx < (ptrdiff_t)pt->sizekgc) {
       GCobj *gc = proto_kgc(pt, idx);
+      if (gc->gch.gct == ~LJ_TPROTO && proto_islazy(gco2pt(gc)))
+	gc = obj2gco(lj_bcread_lazy(L, pt, gco2pt(gc)));
+      else if (gc->gch.gct == ~LJ_TTAB && tab_islazy(gco2tab(gc)))
+	lj_bcread_ktab(L, gco2tab(gc));
       setgcV(L, L->top-1, gc, ~gc->gch.gct);
       return 1;
     }
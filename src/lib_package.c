@@ -350,6 +350,37 @@ static int lj_cf_package_searchpath(lua_State *L)
   }
 }
 
+static int lj_cf_package_loadcache(lua_State *L)
+{
+  luaL_setloadcache(L, luaL_optstring(L, 1, NULL));
+  return 0;
+}
+
+static int lj_cf_package_loadfiles(lua_State *L)
+{
+  int nthreads = luaL_optint(L, 2, 0);
+  const char *mode = luaL_optstring(L, 3, NULL);
+  int i, n, status;
+  const char **names;
+  luaL_checktype(L, 1, LUA_TTABLE);
+  n = (int)lua_objlen(L, 1);
+  names = (const char **)lua_newuserdata(L, (size_t)n*sizeof(const char *));
+  for (i = 0; i < n; i++) {
+    lua_rawgeti(L, 1, i+1);
+    if (lua_type(L, -1) != LUA_TSTRING)
+      luaL_error(L, "bad file name at index %d in " LUA_QL("loadfiles"), i+1);
+    names[i] = lua_tostring(L, -1);  /* Anchored by the argument table. */
+    lua_pop(L, 1);
+  }
+  status = luaL_loadfilesx(L, names, n, nthreads, mode);
+  if (status != LUA_OK) {
+    lua_pushnil(L);
+    lua_insert(L, -2);
+    return 2;  /* return nil + error message */
+  }
+  return 1;
+}
+
 static const char *findfile(lua_State *L, const char *name,
 			    const char *pname)
 {
@@ -569,6 +600,8 @@ static void setpath(lua_State *L, const char *fieldname, const char *envname,
 }
 
 static const luaL_Reg package_lib[] = {
+  { "loadcache",  lj_cf_package_loadcache },
+  { "loadfiles",  lj_cf_package_loadfiles },
   { "loadlib",	lj_cf_package_loadlib },
   { "searchpath",  lj_cf_package_searchpath },
   { "seeall",	lj_cf_package_seeall },
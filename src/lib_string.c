@@ -123,10 +123,22 @@ static int writer_buf(lua_State *L, const void *p, size_t size, void *sb)
 LJLIB_CF(string_dump)
 {
   GCfunc *fn = lj_lib_checkfunc(L, 1);
-  int strip = L->base+1 < L->top && tvistruecond(L->base+1);
-  SBuf *sb = lj_buf_tmp_(L);  /* Assumes lj_bcwrite() doesn't use tmpbuf. */
+  uint32_t flags = 0;
+  SBuf *sb;
+  TValue *o = L->base+1;
+  if (o < L->top && tvistruecond(o)) {
+    flags = BCDUMP_F_STRIP;
+    if (tvisstr(o)) {  /* Mode string of only s = strip and i = indexed? */
+      const char *mode = strVdata(o), *e = mode + strV(o)->len;
+      uint32_t f = 0;
+      for (; mode < e && (*mode == 's' || *mode == 'i'); mode++)
+	f |= *mode == 's' ? BCDUMP_F_STRIP : BCDUMP_F_INDEX;
+      if (mode == e && (f & BCDUMP_F_INDEX)) flags = f;
+    }
+  }
+  sb = lj_buf_tmp_(L);  /* Assumes lj_bcwrite() doesn't use tmpbuf. */
   L->top = L->base+1;
-  if (!isluafunc(fn) || lj_bcwrite(L, funcproto(fn), writer_buf, sb, strip))
+  if (!isluafunc(fn) || lj_bcwrite(L, funcproto(fn), writer_buf, sb, flags))
     lj_err_caller(L, LJ_ERR_STRDUMP);
   setstrV(L, L->top-1, lj_buf_str(L, sb));
   lj_gc_check(L);
@@ -129,25 +129,55 @@ LJLIB_LUA(table_remove) /*
   end
 */
 
-LJLIB_LUA(table_move) /*
-  function(a1, f, e, t, a2)
-    CHECK_tab(a1)
-    CHECK_int(f)
-    CHECK_int(e)
-    CHECK_int(t)
-    if a2 == nil then a2 = a1 end
-    CHECK_tab(a2)
-    if e >= f then
-      local d = t - f
-      if t > e or t <= f or a2 ~= a1 then
-	for i=f,e do a2[i+d] = a1[i] end
-      else
-	for i=e,f,-1 do a2[i+d] = a1[i] end
-      end
-    end
-    return a2
-  end
-*/
+LJLIB_CF(table_move)		LJLIB_REC(.)
+{
+  GCtab *src = lj_lib_checktab(L, 1);
+  int32_t f = lj_lib_checkint(L, 2);
+  int32_t e = lj_lib_checkint(L, 3);
+  int32_t t = lj_lib_checkint(L, 4);
+  GCtab *dst = (L->base+4 < L->top && !tvisnil(L->base+4)) ?
+	       lj_lib_checktab(L, 5) : src;
+  if (e >= f) {
+    if ((int64_t)e - f >= 0x7fffffff || (int64_t)t + (e - f) > 0x7fffffff)
+      lj_err_caller(L, LJ_ERR_TABMOV);
+    if (tabref(src->metatable) || tabref(dst->metatable)) {
+      /* Slow path: honor __index and __newindex, one element at a time. */
+      int di = dst == src ? 1 : 5;
+      int32_t i, n = e - f;
+      int up = (t > e || t <= f || dst != src);
+      for (i = 0; i <= n; i++) {
+	int32_t k = up ? i : n - i;
+	lua_pushinteger(L, t + k);
+	lua_pushinteger(L, f + k);
+	lua_gettable(L, 1);
+	lua_settable(L, di);
+      }
+    } else {
+      lj_tab_move(L, src, f, e, t, dst);
+    }
+  }
+  settabV(L, L->top++, dst);
+  return 1;
+}
+
+LJLIB_CF(table_compact)
+{
+  GCtab *t = lj_lib_checktab(L, 1);
+  lj_tab_rehash(L, t);
+  return 0;
+}
+
+LJLIB_CF(table_ordered)
+{
+  GCtab *t = lj_lib_checktab(L, 1);
+#if LJ_HASTABORD
+  lj_tab_order(L, t);
+#else
+  lj_err_caller(L, LJ_ERR_TABORD);
+#endif
+  settabV(L, L->top++, t);
+  return 1;
+}
 
 LJLIB_CF(table_concat)		LJLIB_REC(.)
 {
@@ -171,91 +201,197 @@ LJLIB_CF(table_concat)		LJLIB_REC(.)
 
 /* ------------------------------------------------------------------------ */
 
-static void set2(lua_State *L, int i, int j)
+/* Typed sort of a TValue array holding only numbers or only strings. */
+
+#define SORT_INSERT	12	/* Max. range size for insertion sort. */
+
+static LJ_AINLINE int sort_lt(cTValue *a, cTValue *b, int isstr)
 {
-  lua_rawseti(L, 1, i);
-  lua_rawseti(L, 1, j);
+  return isstr ? lj_str_cmp(strV(a), strV(b)) < 0 :
+		 numberVnum(a) < numberVnum(b);
 }
 
-static int sort_comp(lua_State *L, int a, int b)
+/* Heapsort a[lo..hi], once quicksort went too deep. */
+static void sort_heap(lua_State *L, TValue *a, MSize lo, MSize hi, int isstr)
 {
-  if (!lua_isnil(L, 2)) {  /* function? */
-    int res;
-    lua_pushvalue(L, 2);
-    lua_pushvalue(L, a-1);  /* -1 to compensate function */
-    lua_pushvalue(L, b-2);  /* -2 to compensate function and `a' */
-    lua_call(L, 2, 1);
-    res = lua_toboolean(L, -1);
-    lua_pop(L, 1);
-    return res;
-  } else {  /* a < b? */
-    return lua_lessthan(L, a, b);
+  MSize e = hi-lo+1, k = e/2+1;
+  a += lo-1;  /* Use 1-based heap indexes. */
+  for (;;) {
+    MSize r, c;
+    TValue v;
+    if (k > 1) {
+      r = --k;
+    } else {
+      if (e <= 1) break;
+      copyTV(L, &v, &a[1]); copyTV(L, &a[1], &a[e]); copyTV(L, &a[e], &v);
+      r = 1; e--;
+    }
+    copyTV(L, &v, &a[r]);
+    while ((c = 2*r) <= e) {  /* Sift down. */
+      if (c < e && sort_lt(&a[c], &a[c+1], isstr)) c++;
+      if (!sort_lt(&v, &a[c], isstr)) break;
+      copyTV(L, &a[r], &a[c]);
+      r = c;
+    }
+    copyTV(L, &a[r], &v);
   }
 }
 
-static void auxsort(lua_State *L, int l, int u)
+/* Introsort a[0..n-1]. The larger partition is deferred to a stack. */
+static void sort_typed(lua_State *L, TValue *a, MSize n, int isstr)
 {
-  while (l < u) {  /* for tail recursion */
-    int i, j;
-    /* sort elements a[l], a[(l+u)/2] and a[u] */
-    lua_rawgeti(L, 1, l);
-    lua_rawgeti(L, 1, u);
-    if (sort_comp(L, -1, -2))  /* a[u] < a[l]? */
-      set2(L, l, u);  /* swap a[l] - a[u] */
-    else
-      lua_pop(L, 2);
-    if (u-l == 1) break;  /* only 2 elements */
-    i = (l+u)/2;
-    lua_rawgeti(L, 1, i);
-    lua_rawgeti(L, 1, l);
-    if (sort_comp(L, -2, -1)) {  /* a[i]<a[l]? */
-      set2(L, i, l);
+  MSize st[3*32], sp = 0, lo = 0, hi = n-1, depth = 2*lj_fls(n);
+  for (;;) {
+    if (hi-lo < SORT_INSERT) {
+      MSize i, j;
+      for (i = lo+1; i <= hi; i++) {
+	TValue v;
+	copyTV(L, &v, &a[i]);
+	for (j = i; j > lo && sort_lt(&v, &a[j-1], isstr); j--)
+	  copyTV(L, &a[j], &a[j-1]);
+	copyTV(L, &a[j], &v);
+      }
+      if (sp == 0) break;
+      depth = st[--sp]; hi = st[--sp]; lo = st[--sp];
+    } else if (depth == 0) {
+      sort_heap(L, a, lo, hi, isstr);
+      hi = lo;
     } else {
-      lua_pop(L, 1);  /* remove a[l] */
-      lua_rawgeti(L, 1, u);
-      if (sort_comp(L, -1, -2))  /* a[u]<a[i]? */
-	set2(L, i, u);
-      else
-	lua_pop(L, 2);
-    }
-    if (u-l == 2) break;  /* only 3 elements */
-    lua_rawgeti(L, 1, i);  /* Pivot */
-    lua_pushvalue(L, -1);
-    lua_rawgeti(L, 1, u-1);
-    set2(L, i, u-1);
-    /* a[l] <= P == a[u-1] <= a[u], only need to sort from l+1 to u-2 */
-    i = l; j = u-1;
-    for (;;) {  /* invariant: a[l..i] <= P <= a[j..u] */
-      /* repeat ++i until a[i] >= P */
-      while (lua_rawgeti(L, 1, ++i), sort_comp(L, -1, -2)) {
-	if (i>=u) lj_err_caller(L, LJ_ERR_TABSORT);
-	lua_pop(L, 1);  /* remove a[i] */
+      MSize mid = lo+(hi-lo)/2, i = lo, j = hi-1;
+      TValue p;
+      depth--;
+      /* Median of three: a[lo] <= a[hi-1] = pivot <= a[hi]. */
+      if (sort_lt(&a[mid], &a[lo], isstr)) {
+	copyTV(L, &p, &a[lo]); copyTV(L, &a[lo], &a[mid]); copyTV(L, &a[mid], &p);
       }
-      /* repeat --j until a[j] <= P */
-      while (lua_rawgeti(L, 1, --j), sort_comp(L, -3, -1)) {
-	if (j<=l) lj_err_caller(L, LJ_ERR_TABSORT);
-	lua_pop(L, 1);  /* remove a[j] */
+      if (sort_lt(&a[hi], &a[mid], isstr)) {
+	copyTV(L, &p, &a[hi]); copyTV(L, &a[hi], &a[mid]); copyTV(L, &a[mid], &p);
+	if (sort_lt(&a[mid], &a[lo], isstr)) {
+	  copyTV(L, &p, &a[lo]); copyTV(L, &a[lo], &a[mid]);
+	  copyTV(L, &a[mid], &p);
+	}
       }
-      if (j<i) {
-	lua_pop(L, 3);  /* pop pivot, a[i], a[j] */
-	break;
+      copyTV(L, &p, &a[mid]); copyTV(L, &a[mid], &a[hi-1]);
+      copyTV(L, &a[hi-1], &p);
+      for (;;) {
+	TValue v;
+	while (sort_lt(&a[++i], &p, isstr)) ;
+	while (sort_lt(&p, &a[--j], isstr)) ;
+	if (j < i) break;
+	copyTV(L, &v, &a[i]); copyTV(L, &a[i], &a[j]); copyTV(L, &a[j], &v);
+      }
+      copyTV(L, &a[hi-1], &a[i]); copyTV(L, &a[i], &p);
+      if (i-lo < hi-i) {
+	st[sp++] = i+1; st[sp++] = hi; st[sp++] = depth;
+	hi = i-1;
+      } else {
+	st[sp++] = lo; st[sp++] = i-1; st[sp++] = depth;
+	lo = i+1;
       }
-      set2(L, i, j);
-    }
-    lua_rawgeti(L, 1, u-1);
-    lua_rawgeti(L, 1, i);
-    set2(L, u-1, i);  /* swap pivot (a[u-1]) with a[i] */
-    /* a[l..i-1] <= a[i] == P <= a[i+1..u] */
-    /* adjust so that smaller half is in [j..i] and larger one in [l..u] */
-    if (i-l < u-i) {
-      j=l; i=i-1; l=i+2;
-    } else {
-      j=i+1; i=u; u=j-2;
     }
-    auxsort(L, j, i);  /* call recursively the smaller one */
-  }  /* repeat the routine for the larger one */
+  }
 }
 
+/* Sort engine for comparators and all other element types. CHECK_tab(t)
+** turns all t[k] with a variable key into the raw TGETR/TSETR, so no
+** metamethods are called, like lua_rawgeti()/lua_rawseti() did. Only index
+** t itself with variable keys, not an alias or a constant.
+*/
+LJLIB_NOREGUV LJLIB_LUA(table_sort_lt) /*
+  function(a, b)
+    return a < b
+  end
+*/
+
+LJLIB_PUSH(lastcl)
+LJLIB_NOREGUV LJLIB_LUA(table_sort_aux) /*
+  function(t, n, lt)
+    CHECK_tab(t)
+    local st, sp = {}, 0
+    local lo, hi, depth, m = 1, n, 0, n
+    while m > 1 do depth = depth + 2; m = m * 0.5 end
+    while true do
+      if hi - lo < 12 then
+	for i = lo + 1, hi do
+	  local v, j = t[i], i - 1
+	  while j >= lo and lt(v, t[j]) do
+	    t[j+1] = t[j]
+	    j = j - 1
+	  end
+	  t[j+1] = v
+	end
+	if sp == 0 then return false end
+	lo, hi, depth = st[sp-2], st[sp-1], st[sp]
+	sp = sp - 3
+      elseif depth == 0 then
+	local e = hi - lo + 1
+	local k = e + 1
+	while true do
+	  local r
+	  if k > 1 then
+	    k = k - 1
+	    r = k
+	  else
+	    if e <= 1 then break end
+	    t[lo], t[lo+e-1] = t[lo+e-1], t[lo]
+	    e = e - 1
+	    r = 1
+	  end
+	  local v = t[lo+r-1]
+	  while true do
+	    local c = r * 2
+	    if c > e then break end
+	    if c < e and lt(t[lo+c-1], t[lo+c]) then c = c + 1 end
+	    if not lt(v, t[lo+c-1]) then break end
+	    t[lo+r-1] = t[lo+c-1]
+	    r = c
+	  end
+	  t[lo+r-1] = v
+	end
+	hi = lo
+      else
+	local mid = 1
+	while mid * 4 <= hi - lo do mid = mid * 2 end
+	mid = lo + mid  -- Keys must stay integers, so no division here.
+	local a, b, c = t[lo], t[mid], t[hi]
+	depth = depth - 1
+	if lt(b, a) then a, b = b, a end
+	if lt(c, b) then
+	  b, c = c, b
+	  if lt(b, a) then a, b = b, a end
+	end
+	t[lo], t[mid], t[hi] = a, t[hi-1], c
+	t[hi-1] = b
+	local i, j = lo, hi - 1
+	while true do
+	  i = i + 1
+	  while lt(t[i], b) do
+	    if i >= hi - 1 then return true end
+	    i = i + 1
+	  end
+	  j = j - 1
+	  while lt(b, t[j]) do
+	    if j <= lo then return true end
+	    j = j - 1
+	  end
+	  if j < i then break end
+	  t[i], t[j] = t[j], t[i]
+	end
+	t[hi-1], t[i] = t[i], b
+	sp = sp + 3
+	if i - lo < hi - i then
+	  st[sp-2], st[sp-1], st[sp] = i + 1, hi, depth
+	  hi = i - 1
+	else
+	  st[sp-2], st[sp-1], st[sp] = lo, i - 1, depth
+	  lo = i + 1
+	end
+      end
+    end
+  end
+*/
+
+LJLIB_PUSH(lastcl)
 LJLIB_CF(table_sort)
 {
   GCtab *t = lj_lib_checktab(L, 1);
@@ -263,7 +399,32 @@ LJLIB_CF(table_sort)
   lua_settop(L, 2);
   if (!tvisnil(L->base+1))
     lj_lib_checkfunc(L, 2);
-  auxsort(L, 1, n);
+  if (n < 2)
+    return 0;
+  if (tvisnil(L->base+1) && (uint32_t)n < t->asize) {
+    TValue *a = arrayslot(t, 1);
+    int32_t i;
+    int isstr = tvisstr(a);
+    for (i = 0; i < n; i++)
+      if (isstr ? !tvisstr(&a[i]) :
+		  !(tvisint(&a[i]) || (tvisnum(&a[i]) && !tvisnan(&a[i]))))
+	break;
+    if (i == n) {  /* Only numbers (without NaNs) or only strings? */
+      lj_tab_checkcow(L, t);
+      sort_typed(L, arrayslot(t, 1), (MSize)n, isstr);
+      return 0;
+    }
+  }
+  /* Run the sort engine with the comparator or the < operator. */
+  copyTV(L, L->top, lj_lib_upvalue(L, 2));
+  settabV(L, L->top+1, t);
+  setintV(L->top+2, n);
+  copyTV(L, L->top+3,
+	 tvisnil(L->base+1) ? lj_lib_upvalue(L, 1) : L->base+1);
+  L->top += 4;
+  lua_call(L, 3, 1);
+  if (tvistruecond(L->top-1))
+    lj_err_caller(L, LJ_ERR_TABSORT);
   return 0;
 }
 
@@ -295,7 +456,9 @@ LJLIB_NOREG LJLIB_CF(table_new)		LJLIB_REC(.)
 
 LJLIB_NOREG LJLIB_CF(table_clear)	LJLIB_REC(.)
 {
-  lj_tab_clear(lj_lib_checktab(L, 1));
+  GCtab *t = lj_lib_checktab(L, 1);
+  lj_tab_checkcow(L, t);
+  lj_tab_clear(t);
   return 0;
 }
 
@@ -723,6 +723,38 @@ LUA_API void lua_createtable(lua_State *L, int narray, int nrec)
   incr_top(L);
 }
 
+LUA_API void lua_pushnumberarray(lua_State *L, const lua_Number *a, int n)
+{
+  GCtab *t;
+  TValue *array;
+  int i;
+  lj_checkapi(n >= 0, "negative array size");
+  lj_gc_check(L);
+  t = lj_tab_new_ah(L, n, 0);
+  settabV(L, L->top, t);
+  incr_top(L);
+  array = tvref(t->array);
+  for (i = 1; i <= n; i++) {
+    setnumV(&array[i], a[i-1]);
+    if (LJ_UNLIKELY(tvisnan(&array[i])))
+      setnanV(&array[i]);  /* Canonicalize injected NaNs. */
+  }
+}
+
+LUA_API void lua_pushstringarray(lua_State *L, const char *const *a, int n)
+{
+  GCtab *t;
+  int i;
+  lj_checkapi(n >= 0, "negative array size");
+  lj_gc_check(L);
+  t = lj_tab_new_ah(L, n, 0);
+  settabV(L, L->top, t);
+  incr_top(L);
+  for (i = 1; i <= n; i++)  /* NOBARRIER: The table is new (marked white). */
+    if (a[i-1])
+      setstrV(L, arrayslot(t, i), lj_str_newz(L, a[i-1]));
+}
+
 LUALIB_API int luaL_newmetatable(lua_State *L, const char *tname)
 {
   GCtab *regt = tabV(registry(L));
@@ -1291,6 +1323,24 @@ LUA_API int lua_gc(lua_State *L, int what, int data)
   case LUA_GCISRUNNING:
     res = (g->gc.threshold != LJ_MAX_MEM);
     break;
+  case LUA_GCSETLOADLIMIT:
+    res = (int)(g->gc.loadlimit >> 10);
+    if (data <= 0)
+      g->gc.loadlimit = 0;
+    else if ((GCSize)data > (GCSize)(LJ_MAX_MEM >> 10))  /* Avoid overflow. */
+      g->gc.loadlimit = (GCSize)LJ_MAX_MEM;
+    else
+      g->gc.loadlimit = (GCSize)data << 10;
+    break;
+  case LUA_GCLOADSTATS:
+    switch (data) {
+    case 0: res = (int)g->gc.loadnum; break;
+    case 1: res = (int)g->gc.loadstep; break;
+    case 2: res = (int)g->gc.loadcycle; break;
+    case 3: res = (int)(g->gc.loadpeak >> 10); break;
+    default: res = -1; break;
+    }
+    break;
   default:
     res = -1;  /* Invalid option. */
   }
@@ -579,6 +579,20 @@
 #define LJ_HASBUFFER		1
 #endif
 
+/* Shared tables need a check in the table stores of the interpreter. */
+#if LJ_GC64 && (LJ_TARGET_X64 || LJ_TARGET_ARM64)
+#define LJ_HASTABCOW		1
+#else
+#define LJ_HASTABCOW		0
+#endif
+
+/* Ordered hash parts need support in BC_ITERN and lj_vm_next. */
+#if LJ_GC64 && LJ_TARGET_X64
+#define LJ_HASTABORD		1
+#else
+#define LJ_HASTABORD		0
+#endif
+
 #if defined(LUAJIT_DISABLE_PROFILE)
 #define LJ_HASPROFILE		0
 #elif LJ_TARGET_POSIX
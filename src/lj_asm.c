@@ -1116,7 +1116,10 @@ static void asm_tnew(ASMState *as, IRIns *ir)
 
 static void asm_tdup(ASMState *as, IRIns *ir)
 {
-  const CCallInfo *ci = &lj_ir_callinfo[IRCALL_lj_tab_dup];
+  /* Tables stored to in the trace are copied. Others may share storage. */
+  const CCallInfo *ci = &lj_ir_callinfo[(ir->op2 || !LJ_HASTABCOW) ?
+					  IRCALL_lj_tab_dup :
+					  IRCALL_lj_tab_dupcow];
   IRRef args[2];
   asm_snap_prep(as);
   args[0] = ASMREF_L;  /* lua_State *L    */
@@ -2097,7 +2100,8 @@ static void asm_tail_link(ASMState *as)
     case BC_CALLM: case BC_CALLMT:
       mres -= (int32_t)(1 + LJ_FR2 + bc_a(*pc) + bc_c(*pc)); break;
     case BC_RETM: mres -= (int32_t)(bc_a(*pc) + bc_d(*pc)); break;
-    case BC_TSETM: mres -= (int32_t)bc_a(*pc); break;
+    case BC_TSETM: case BC_TSTML: case BC_TSETMR:
+      mres -= (int32_t)bc_a(*pc); break;
     default: if (bc_op(*pc) < BC_FUNCF) mres = 0; break;
     }
     ra_allockreg(as, mres, RID_RET);  /* Return MULTRES or 0. */
@@ -152,62 +152,67 @@
   /* 3F */ _(TSETM,	base,	___,	num,	newindex) \
   /* 40 */ _(TSETR,	var,	var,	var,	newindex) \
   \
+  /* Insert at a running index. */ \
+  /* 41 */ _(TINS,	var,	var,	var,	newindex) \
+  \
+  /* Ops for > 64K constants. TSTML and xxxX take the index lo-word from */ \
+  /* the NOP operand word that follows them. */ \
+  /* 42 */ _(NOP,	___,	___,	lit,	___) \
+  /* 43 */ _(TSTML,	base,	___,	num,	newindex) \
+  /* 44 */ _(KSTRX,	dst,	___,	str,	___) \
+  /* 45 */ _(KCDTX,	dst,	___,	cdata,	___) \
+  /* 46 */ _(KNUMX,	dst,	___,	num,	___) \
+  /* 47 */ _(TDUPX,	dst,	___,	tab,	gc) \
+  /* 48 */ _(FNEWX,	dst,	___,	func,	gc) \
+  /* 49 */ _(GGETX,	dst,	___,	str,	index) \
+  /* 4A */ _(GSETX,	var,	___,	str,	newindex) \
+  \
+  /* Store multiple results at a running index. */ \
+  /* 4B */ _(TSETMR,base,	var,	var,	newindex) \
+  \
   /* Calls and vararg handling. T = tail call. */ \
-  /* 41 */ _(CALLM,	base,	lit,	lit,	call) \
-  /* 42 */ _(CALL,	base,	lit,	lit,	call) \
-  /* 43 */ _(CALLMT,base,	___,	lit,	call) \
-  /* 44 */ _(CALLT,	base,	___,	lit,	call) \
-  /* 45 */ _(ITERC,	base,	lit,	lit,	call) \
-  /* 46 */ _(ITERN,	base,	lit,	lit,	call) \
-  /* 47 */ _(VARG,	base,	lit,	lit,	___) \
-  /* 48 */ _(ISNEXT,base,	___,	jump,	___) \
+  /* 4C */ _(CALLM,	base,	lit,	lit,	call) \
+  /* 4D */ _(CALL,	base,	lit,	lit,	call) \
+  /* 4E */ _(CALLMT,base,	___,	lit,	call) \
+  /* 4F */ _(CALLT,	base,	___,	lit,	call) \
+  /* 50 */ _(ITERC,	base,	lit,	lit,	call) \
+  /* 51 */ _(ITERN,	base,	lit,	lit,	call) \
+  /* 52 */ _(VARG,	base,	lit,	lit,	___) \
+  /* 53 */ _(ISNEXT,base,	___,	jump,	___) \
   \
   /* Returns. */ \
-  /* 49 */ _(RETM,	base,	___,	lit,	___) \
-  /* 4A */ _(RET,	rbase,	___,	lit,	___) \
-  /* 4B */ _(RET0,	rbase,	___,	lit,	___) \
-  /* 4C */ _(RET1,	rbase,	___,	lit,	___) \
+  /* 54 */ _(RETM,	base,	___,	lit,	___) \
+  /* 55 */ _(RET,	rbase,	___,	lit,	___) \
+  /* 56 */ _(RET0,	rbase,	___,	lit,	___) \
+  /* 57 */ _(RET1,	rbase,	___,	lit,	___) \
   \
   /* Loops and branches. I/J = interp/JIT, I/C/L = init/call/loop. */ \
-  /* 4D */ _(FORI,	base,	___,	jump,	___) \
-  /* 4E */ _(JFORI,	base,	___,	jump,	___) \
+  /* 58 */ _(FORI,	base,	___,	jump,	___) \
+  /* 59 */ _(JFORI,	base,	___,	jump,	___) \
   \
-  /* 4F */ _(FORL,	base,	___,	jump,	___) \
-  /* 50 */ _(IFORL,	base,	___,	jump,	___) \
-  /* 51 */ _(JFORL,	base,	___,	lit,	___) \
+  /* 5A */ _(FORL,	base,	___,	jump,	___) \
+  /* 5B */ _(IFORL,	base,	___,	jump,	___) \
+  /* 5C */ _(JFORL,	base,	___,	lit,	___) \
   \
-  /* 52 */ _(ITERL,	base,	___,	jump,	___) \
-  /* 53 */ _(IITERL,base,	___,	jump,	___) \
-  /* 54 */ _(JITERL,base,	___,	lit,	___) \
+  /* 5D */ _(ITERL,	base,	___,	jump,	___) \
+  /* 5E */ _(IITERL,base,	___,	jump,	___) \
+  /* 5F */ _(JITERL,base,	___,	lit,	___) \
   \
-  /* 55 */ _(LOOP,	rbase,	___,	jump,	___) \
-  /* 56 */ _(ILOOP,	rbase,	___,	jump,	___) \
-  /* 57 */ _(JLOOP,	rbase,	___,	lit,	___) \
+  /* 60 */ _(LOOP,	rbase,	___,	jump,	___) \
+  /* 61 */ _(ILOOP,	rbase,	___,	jump,	___) \
+  /* 62 */ _(JLOOP,	rbase,	___,	lit,	___) \
   \
-  /* 58 */ _(JMP,	rbase,	___,	jump,	___) \
+  /* 63 */ _(JMP,	rbase,	___,	jump,	___) \
   \
   /* Function headers. I/J = interp/JIT, F/V/C = fixarg/vararg/C func. */ \
-  /* 59 */ _(FUNCF,	rbase,	___,	___,	___) \
-  /* 5A */ _(IFUNCF,rbase,	___,	___,	___) \
-  /* 5B */ _(JFUNCF,rbase,	___,	lit,	___) \
-  /* 5C */ _(FUNCV,	rbase,	___,	___,	___) \
-  /* 5D */ _(IFUNCV,rbase,	___,	___,	___) \
-  /* 5E */ _(JFUNCV,rbase,	___,	lit,	___) \
-  /* 5F */ _(FUNCC,	rbase,	___,	___,	___) \
-  /* 60 */ _(FUNCCW,rbase,	___,	___,	___) \
-  \
-  /* Additional opcodes. */ \
-  /* 61 */ _(KINTLO, dst,   ___,  lit,  ___) \
-  /* 62 */ _(TDUPHI, dst,   ___,  tab,  gc) \
-  /* 63 */ _(KINTHI, dst,   ___,  lit,  ___) \
-  /* 64 */ _(KSTRHI, dst,   ___,  str,  ___) \
-  /* 65 */ _(KCDTHI, dst,   ___,  lit,  ___) \
-  /* 66 */ _(KNUMHI, dst,   ___,  num,  ___) \
-  /* 67 */ _(GGETV,  dst,	  ___,  var,  index) \
-  /* 68 */ _(GSETV,  var, 	___,  var,  newindex) \
-  /* 69 */ _(TINS,	 var,	  var,	var,	newindex) \
-  /* 6A */ _(NOP,    ___,	  ___,	lit,	___) \
-  /* 6B */ _(TSTML,  base,	___,	num,	newindex)
+  /* 64 */ _(FUNCF,	rbase,	___,	___,	___) \
+  /* 65 */ _(IFUNCF,rbase,	___,	___,	___) \
+  /* 66 */ _(JFUNCF,rbase,	___,	lit,	___) \
+  /* 67 */ _(FUNCV,	rbase,	___,	___,	___) \
+  /* 68 */ _(IFUNCV,rbase,	___,	___,	___) \
+  /* 69 */ _(JFUNCV,rbase,	___,	lit,	___) \
+  /* 6A */ _(FUNCC,	rbase,	___,	___,	___) \
+  /* 6B */ _(FUNCCW,rbase,	___,	___,	___)
 
 /* Bytecode opcode numbers. */
 typedef enum {
@@ -272,6 +277,22 @@ static LJ_AINLINE int bc_isret(BCOp op)
   return (op == BC_RETM || op == BC_RET || op == BC_RET0 || op == BC_RET1);
 }
 
+/* TSTML and the xxxX ops hold the hi-word of a constant index in D. They are
+** followed by a NOP operand word with the same RA and the lo-word in D.
+*/
+static LJ_AINLINE int bc_iswide(BCOp op)
+{
+  return (op >= BC_TSTML && op <= BC_GSETX);
+}
+
+#define bc_dx(p)	((bc_d((p)[0]) << 16) | bc_d((p)[1]))
+
+/* Ops that are not part of the original instruction set. */
+static LJ_AINLINE int bc_isext(BCOp op)
+{
+  return (op >= BC_TINS && op <= BC_TSETMR);
+}
+
 LJ_DATA const uint16_t lj_bc_mode[];
 LJ_DATA const uint16_t lj_bc_ofs[];
 
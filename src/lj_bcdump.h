@@ -12,13 +12,15 @@
 /* -- Bytecode dump format ------------------------------------------------ */
 
 /*
-** dump   = header proto+ 0U
+** dump   = header [index] proto+ 0U
 ** header = ESC 'L' 'J' versionB flagsU [namelenU nameB*]
+** index  = numprotoU datalenU protoofsW*
 ** proto  = lengthU pdata
 ** pdata  = phead bcinsW* uvdataH* kgc* knum* [debugB*]
 ** phead  = flagsB numparamsB framesizeB numuvB numkgcU numknU numbcU
 **          [debuglenU [firstlineU numlineU]]
-** kgc    = kgctypeU { ktab | (loU hiU) | (rloU rhiU iloU ihiU) | strB* }
+** kgc    = kgctypeU { ktab | (loU hiU) | (rloU rhiU iloU ihiU) | strB* |
+**                     childU }
 ** knum   = intU0 | (loU1 hiU)
 ** ktab   = narrayU nhashU karray* khash*
 ** karray = ktabk
@@ -26,6 +28,13 @@
 ** ktabk  = ktabtypeU { intU | (loU hiU) | strB* }
 **
 ** B = 8 bit, H = 16 bit, W = 32 bit, U = ULEB128 of W, U0/U1 = ULEB128 of W+1
+**
+** The index and the child numbers are only present with BCDUMP_F_INDEX.
+** BCDUMP_F_XOPS is set if any prototype uses an opcode that is not part of
+** the original instruction set, see bc_isext(). The reader rejects them
+** without it and verifies the operands of all instructions.
+** Prototypes are numbered in dump order (children first, main one last).
+** protoofsW is the offset of a proto from the start of the first one.
 */
 
 /* Bytecode dump header. */
@@ -35,16 +44,19 @@
 
 /* If you perform *any* kind of private modifications to the bytecode itself
 ** or to the dump format, you *must* set BCDUMP_VERSION to 0x80 or higher.
+** Bump it whenever opcodes are added or renumbered.
 */
-#define BCDUMP_VERSION		2
+#define BCDUMP_VERSION		0x81
 
 /* Compatibility flags. */
 #define BCDUMP_F_BE		0x01
 #define BCDUMP_F_STRIP		0x02
 #define BCDUMP_F_FFI		0x04
 #define BCDUMP_F_FR2		0x08
+#define BCDUMP_F_INDEX		0x10
+#define BCDUMP_F_XOPS		0x20
 
-#define BCDUMP_F_KNOWN		(BCDUMP_F_FR2*2-1)
+#define BCDUMP_F_KNOWN		(BCDUMP_F_XOPS*2-1)
 
 /* Type codes for the GC constants of a prototype. Plus length for strings. */
 enum {
@@ -61,8 +73,11 @@ enum {
 /* -- Bytecode reader/writer ---------------------------------------------- */
 
 LJ_FUNC int lj_bcwrite(lua_State *L, GCproto *pt, lua_Writer writer,
-		       void *data, int strip);
+		       void *data, uint32_t flags);
 LJ_FUNC GCproto *lj_bcread_proto(LexState *ls);
 LJ_FUNC GCproto *lj_bcread(LexState *ls);
+LJ_FUNC GCproto *lj_bcread_lazy(lua_State *L, GCproto *parent, GCproto *pt);
+LJ_FUNC void lj_bcread_ktab(lua_State *L, GCtab *t);
+LJ_FUNC void lj_load_freestate(global_State *g);
 
 #endif
@@ -12,6 +12,7 @@
 #include "lj_buf.h"
 #include "lj_str.h"
 #include "lj_tab.h"
+#include "lj_udata.h"
 #include "lj_bc.h"
 #if LJ_HASFFI
 #include "lj_ctype.h"
@@ -30,6 +31,36 @@
 #define bcread_oldtop(L, ls)	restorestack(L, ls->lastline)
 #define bcread_savetop(L, ls, top) \
   ls->lastline = (BCLine)savestack(L, (top))
+#define bcread_curidx(ls)	ls->linenumber
+
+/* Data of an indexed bytecode dump, retained in a userdata for lazy loading.
+**
+** Only the main prototype is read at load time. Its children are stubs
+** without bytecode, which hold this userdata as their only GC constant and
+** are read on first use. The upvalue refs of a stub are valid, since the JIT
+** compiler inspects them. firstline holds the number of the prototype and
+** numline the negated index of the stub in the GC constants of its parent.
+**
+** Large template tables are kept serialized, too. Their stub is an empty
+** table whose first node holds this userdata as key and the offset of the
+** serialized table as value. It is filled in place by the first TDUP.
+**
+** The prototype data follows the offsets, unless the dump was loaded from
+** frozen input. Then it is read in place and shared by all states that
+** loaded the same input, see luaL_loadbufferfrozen().
+*/
+typedef struct BCIndex {
+  uint32_t flags;	/* Dump flags. */
+  MSize nproto;		/* Number of prototypes. */
+  MSize len;		/* Length of prototype data. */
+  const char *data;	/* Prototype data. */
+  MSize ofs[1];		/* Prototype offsets. */
+} BCIndex;
+
+#define bcindex_data(bi)	((bi)->data)
+
+/* Min. number of entries of a template table that is read lazily. */
+#define BCREAD_KTAB_LAZY	16
 
 /* -- Input buffer handling ----------------------------------------------- */
 
@@ -197,12 +228,9 @@ static void bcread_ktabk(LexState *ls, TValue *o)
   }
 }
 
-/* Read a template table. */
-static GCtab *bcread_ktab(LexState *ls)
+/* Read the entries of a template table. */
+static void bcread_ktabfill(LexState *ls, GCtab *t, MSize narray, MSize nhash)
 {
-  MSize narray = bcread_uleb128(ls);
-  MSize nhash = bcread_uleb128(ls);
-  GCtab *t = lj_tab_new(ls->L, narray, hsize2hbits(nhash));
   if (narray) {  /* Read array entries. */
     MSize i;
     TValue *o = tvref(t->array);
@@ -218,9 +246,129 @@ static GCtab *bcread_ktab(LexState *ls)
       bcread_ktabk(ls, lj_tab_set(ls->L, t, &key));
     }
   }
+}
+
+/* Read a template table. */
+static GCtab *bcread_ktab(LexState *ls)
+{
+  MSize narray = bcread_uleb128(ls);
+  MSize nhash = bcread_uleb128(ls);
+  GCtab *t = lj_tab_new(ls->L, narray, hsize2hbits(nhash));
+  bcread_ktabfill(ls, t, narray, nhash);
+  return t;
+}
+
+/* Check and skip a template table of an indexed dump or read a small one. */
+static GCtab *bcread_ktabindex(LexState *ls)
+{
+  const char *p = ls->p;
+  MSize narray = bcread_uleb128(ls);
+  MSize nhash = bcread_uleb128(ls);
+  MSize i, n = narray + 2*nhash;
+  GCtab *t;
+  Node *node;
+  if (narray + nhash < BCREAD_KTAB_LAZY || n < narray) {
+    ls->p = p;
+    return bcread_ktab(ls);
+  }
+  for (i = 0; i < n; i++) {
+    MSize tp;
+    if (ls->p >= ls->pe) bcread_error(ls, LJ_ERR_BCBAD);
+    tp = bcread_uleb128(ls);
+    if (tp >= BCDUMP_KTAB_STR) {
+      if (tp - BCDUMP_KTAB_STR > (MSize)(ls->pe - ls->p))
+	bcread_error(ls, LJ_ERR_BCBAD);
+      ls->p += tp - BCDUMP_KTAB_STR;
+    } else if (tp == BCDUMP_KTAB_INT) {
+      bcread_uleb128(ls);
+    } else if (tp == BCDUMP_KTAB_NUM) {
+      bcread_uleb128(ls);
+      bcread_uleb128(ls);
+    } else if (tp > BCDUMP_KTAB_TRUE || (tp == BCDUMP_KTAB_NIL &&
+	       i >= narray && ((i - narray) & 1) == 0)) {  /* No nil keys. */
+      bcread_error(ls, LJ_ERR_BCBAD);
+    }
+  }
+  if (ls->p > ls->pe) bcread_error(ls, LJ_ERR_BCBAD);
+  t = lj_tab_new(ls->L, 0, 1);
+  node = noderef(t->node);
+  setudataV(ls->L, &node->key, ls->bcindex);
+  setnumV(&node->val,
+	  (lua_Number)(p - bcindex_data((BCIndex *)uddata(ls->bcindex))));
   return t;
 }
 
+/* Read upvalue refs. */
+static void bcread_uv(LexState *ls, GCproto *pt, MSize sizeuv)
+{
+  if (sizeuv) {
+    uint16_t *uv = proto_uv(pt);
+    bcread_block(ls, uv, sizeuv*2);
+    /* Swap upvalue refs if the endianess differs. */
+    if (bcread_swap(ls)) {
+      MSize i;
+      for (i = 0; i < sizeuv; i++)
+	uv[i] = (uint16_t)((uv[i] >> 8)|(uv[i] << 8));
+    }
+  }
+}
+
+/* Create a stub for a child prototype of an indexed dump. */
+static GCproto *bcread_stub(LexState *ls, MSize idx, MSize slot)
+{
+  BCIndex *bi = (BCIndex *)uddata(ls->bcindex);
+  const char *data = bcindex_data(bi), *p = ls->p, *pe = ls->pe;
+  MSize flags, numparams, framesize, sizeuv, sizebc, sizept;
+  GCproto *pt;
+  /* Read the prototype header up to the upvalue refs. */
+  ls->p = data + bi->ofs[idx];
+  ls->pe = data + (idx+1 < bi->nproto ? bi->ofs[idx+1] : bi->len);
+  bcread_uleb128(ls);
+  flags = bcread_byte(ls);
+  numparams = bcread_byte(ls);
+  framesize = bcread_byte(ls);
+  sizeuv = bcread_byte(ls);
+  bcread_uleb128(ls);
+  bcread_uleb128(ls);
+  sizebc = bcread_uleb128(ls);
+  if (!(bcread_flags(ls) & BCDUMP_F_STRIP) && bcread_uleb128(ls)) {
+    bcread_uleb128(ls);
+    bcread_uleb128(ls);
+  }
+  if (ls->p > ls->pe || sizebc > (MSize)(ls->pe - ls->p) >> 2 ||
+      sizeuv*2 > (MSize)(ls->pe - ls->p) - sizebc*(MSize)sizeof(BCIns))
+    bcread_error(ls, LJ_ERR_BCBAD);
+  ls->p += sizebc*(MSize)sizeof(BCIns);
+
+  /* The single GC constant comes right after the upvalue refs. */
+  sizept = (MSize)sizeof(GCproto) + ((sizeuv+1)&~1)*2 + (MSize)sizeof(GCRef);
+  sizept = (sizept + (MSize)sizeof(TValue)-1) & ~((MSize)sizeof(TValue)-1);
+  pt = (GCproto *)lj_mem_newgco(ls->L, sizept);
+  pt->gct = ~LJ_TPROTO;
+  pt->numparams = (uint8_t)numparams;
+  pt->framesize = (uint8_t)framesize;
+  pt->sizebc = 0;
+  setmref(pt->k, (char *)pt + sizept);
+  setmref(pt->uv, (char *)pt + sizeof(GCproto));
+  pt->sizekgc = 1;
+  pt->sizekn = 0;
+  pt->sizept = sizept;
+  pt->sizeuv = (uint8_t)sizeuv;
+  pt->flags = (uint8_t)(flags & (PROTO_CHILD|PROTO_VARARG|PROTO_FFI));
+  pt->trace = 0;
+  setgcref(pt->chunkname, obj2gco(ls->chunkname));
+  pt->firstline = idx;
+  pt->numline = slot;
+  setmref(pt->lineinfo, NULL);
+  setmref(pt->uvinfo, NULL);
+  setmref(pt->varinfo, NULL);
+  setgcref(mref(pt->k, GCRef)[-1], obj2gco(ls->bcindex));
+  bcread_uv(ls, pt, sizeuv);
+  ls->p = p;
+  ls->pe = pe;
+  return pt;
+}
+
 /* Read GC constants of a prototype. */
 static void bcread_kgc(LexState *ls, GCproto *pt, MSize sizekgc)
 {
@@ -233,7 +381,8 @@ static void bcread_kgc(LexState *ls, GCproto *pt, MSize sizekgc)
       const char *p = (const char *)bcread_mem(ls, len);
       setgcref(*kr, obj2gco(lj_str_new(ls->L, p, len)));
     } else if (tp == BCDUMP_KGC_TAB) {
-      setgcref(*kr, obj2gco(bcread_ktab(ls)));
+      setgcref(*kr, obj2gco((bcread_flags(ls) & BCDUMP_F_INDEX) ?
+			    bcread_ktabindex(ls) : bcread_ktab(ls)));
 #if LJ_HASFFI
     } else if (tp != BCDUMP_KGC_CHILD) {
       CTypeID id = tp == BCDUMP_KGC_COMPLEX ? CTID_COMPLEX_DOUBLE :
@@ -249,6 +398,12 @@ static void bcread_kgc(LexState *ls, GCproto *pt, MSize sizekgc)
 	p[1].u32.hi = bcread_uleb128(ls);
       }
 #endif
+    } else if ((bcread_flags(ls) & BCDUMP_F_INDEX)) {
+      MSize idx = bcread_uleb128(ls);
+      lj_assertLS(tp == BCDUMP_KGC_CHILD, "bad constant type %d", tp);
+      if (idx >= bcread_curidx(ls))  /* Children precede their parent. */
+	bcread_error(ls, LJ_ERR_BCBAD);
+      setgcref(*kr, obj2gco(bcread_stub(ls, idx, sizekgc-i)));
     } else {
       lua_State *L = ls->L;
       lj_assertLS(tp == BCDUMP_KGC_CHILD, "bad constant type %d", tp);
@@ -291,19 +446,106 @@ static void bcread_bytecode(LexState *ls, GCproto *pt, MSize sizebc)
   }
 }
 
-/* Read upvalue refs. */
-static void bcread_uv(LexState *ls, GCproto *pt, MSize sizeuv)
+/* Check a slot, upvalue or primitive operand. */
+static int bcread_opok(GCproto *pt, BCMode m, BCReg r)
 {
-  if (sizeuv) {
-    uint16_t *uv = proto_uv(pt);
-    bcread_block(ls, uv, sizeuv*2);
-    /* Swap upvalue refs if the endianess differs. */
-    if (bcread_swap(ls)) {
-      MSize i;
-      for (i = 0; i < sizeuv; i++)
-	uv[i] = (uint16_t)((uv[i] >> 8)|(uv[i] << 8));
+  switch (m) {
+  case BCMdst: case BCMbase: case BCMvar: return r < pt->framesize;
+  case BCMrbase: return r <= pt->framesize;
+  case BCMuv: return r < pt->sizeuv;
+  case BCMpri: return r <= 2;
+  default: return 1;
+  }
+}
+
+/* Check the index and the type of a constant operand. */
+static int bcread_kok(GCproto *pt, BCMode m, uint32_t idx)
+{
+  uint8_t gct;
+  switch (m) {
+  case BCMnum: return idx < pt->sizekn;
+  case BCMstr: gct = ~LJ_TSTR; break;
+  case BCMtab: gct = ~LJ_TTAB; break;
+  case BCMfunc: gct = ~LJ_TPROTO; break;
+  case BCMcdata: gct = ~LJ_TCDATA; break;
+  default: return 1;
+  }
+  return idx < pt->sizekgc && proto_kgc(pt, ~(ptrdiff_t)idx)->gch.gct == gct;
+}
+
+/* Verify the operands of all bytecode instructions in one pass.
+**
+** This catches dumps from a mismatched instruction set or with bad slot,
+** upvalue, constant or jump operands. Control flow and slot types are not
+** checked, so this doesn't make it safe to load untrusted bytecode.
+*/
+static void bcread_verify(LexState *ls, GCproto *pt)
+{
+  const BCIns *bc = proto_bc(pt);
+  MSize pc, sizebc = pt->sizebc;
+  int ext = (bcread_flags(ls) & BCDUMP_F_XOPS);
+  BCOp last = sizebc < 2 ? BC_NOP : bc_op(bc[sizebc-1]);
+  if (pt->framesize > LJ_MAX_SLOTS || pt->numparams > pt->framesize ||
+      !(bc_isret(last) || last == BC_CALLT || last == BC_CALLMT))
+    goto bad;  /* Must not run off the end. */
+  for (pc = 1; pc < sizebc; pc++) {
+    BCIns ins = bc[pc];
+    BCOp op = bc_op(ins);
+    BCReg a = bc_a(ins);
+    /* Only the original FORI/FORL/ITERL/LOOP and no function headers. */
+    if (op >= BC_FUNCF || op == BC_JFORI || op == BC_IFORL ||
+	op == BC_JFORL || op == BC_IITERL || op == BC_JITERL ||
+	op == BC_ILOOP || op == BC_JLOOP || (bc_isext(op) && !ext) ||
+	!bcread_opok(pt, bcmode_a(op), a))
+      goto bad;
+    if (bc_iswide(op)) {  /* Check the index with the NOP operand word. */
+      if (pc+1 >= sizebc || bc_op(bc[pc+1]) != BC_NOP ||
+	  bc_a(bc[pc+1]) != a || !bcread_kok(pt, bcmode_d(op), bc_dx(bc+pc)))
+	goto bad;
+      pc++;
+    } else if (bcmode_hasd(op)) {
+      BCMode md = bcmode_d(op);
+      BCReg d = bc_d(ins);
+      if (md == BCMjump) {
+	ptrdiff_t target = (ptrdiff_t)pc+1 + bc_j(ins);
+	if (target < 1 || target >= (ptrdiff_t)sizebc) goto bad;
+      } else if (!bcread_opok(pt, md, d) || !bcread_kok(pt, md, d)) {
+	goto bad;
+      }
+    } else {
+      BCMode mb = bcmode_b(op), mc = bcmode_c(op);
+      BCReg b = bc_b(ins), c = bc_c(ins);
+      if (!bcread_opok(pt, mb, b) || !bcread_kok(pt, mb, b) ||
+	  !bcread_opok(pt, mc, c) || !bcread_kok(pt, mc, c))
+	goto bad;
+    }
+    /* Ops that read the following instruction and slots implied by ops. */
+    if (op < BC_ISTYPE &&
+	(pc+1 >= sizebc || bc_op(bc[pc+1]) != BC_JMP))
+      goto bad;
+    switch (op) {
+    case BC_KNIL: if (a > bc_d(ins)) goto bad; break;
+    case BC_TSETM: case BC_TSTML: if (a == 0) goto bad; break;
+    case BC_FORI: case BC_FORL:
+      if (a+FORL_EXT >= pt->framesize) goto bad;
+      break;
+    case BC_ITERC: case BC_ITERN:
+      if (a < 3 || a+2+LJ_FR2 >= pt->framesize ||
+	  pc+1 >= sizebc || bc_op(bc[pc+1]) != BC_ITERL)
+	goto bad;
+      break;
+    case BC_ISNEXT: {
+      BCOp top = bc_op(bc[(ptrdiff_t)pc+1 + bc_j(ins)]);
+      if (a < 3 || (top != BC_ITERN && top != BC_ITERC)) goto bad;
+      break;
+      }
+    case BC_ITERL: if (a == 0) goto bad; break;
+    default: break;
     }
   }
+  return;
+bad:
+  bcread_error(ls, LJ_ERR_BCBAD);
 }
 
 /* Read a prototype. */
@@ -367,6 +609,7 @@ GCproto *lj_bcread_proto(LexState *ls)
   bcread_kgc(ls, pt, sizekgc);
   pt->sizekgc = sizekgc;
   bcread_knum(ls, pt, sizekn);
+  bcread_verify(ls, pt);
 
   /* Read and initialize debug info. */
   pt->firstline = firstline;
@@ -385,6 +628,26 @@ GCproto *lj_bcread_proto(LexState *ls)
   return pt;
 }
 
+/* Read a prototype of an indexed dump. */
+static GCproto *bcread_iproto(LexState *ls, MSize idx)
+{
+  BCIndex *bi = (BCIndex *)uddata(ls->bcindex);
+  const char *data = bcindex_data(bi);
+  const char *pe = data + (idx+1 < bi->nproto ? bi->ofs[idx+1] : bi->len);
+  GCproto *pt;
+  MSize len;
+  ls->p = data + bi->ofs[idx];
+  ls->pe = pe;
+  len = bcread_uleb128(ls);
+  if (ls->p + len != pe)
+    bcread_error(ls, LJ_ERR_BCBAD);
+  bcread_curidx(ls) = idx;
+  pt = lj_bcread_proto(ls);
+  if (ls->p != pe)
+    bcread_error(ls, LJ_ERR_BCBAD);
+  return pt;
+}
+
 /* Read and check header of bytecode dump. */
 static int bcread_header(LexState *ls)
 {
@@ -414,6 +677,74 @@ static int bcread_header(LexState *ls)
   return 1;  /* Ok. */
 }
 
+/* Read an indexed bytecode dump. Only the main prototype is read now. */
+static GCproto *bcread_index(LexState *ls)
+{
+  lua_State *L = ls->L;
+  MSize nproto, len, i;
+  const char *p, *pe;
+  GCudata *ud;
+  BCIndex *bi;
+  GCproto *pt;
+  int inplace;
+  bcread_want(ls, 5+5);
+  nproto = bcread_uleb128(ls);
+  len = bcread_uleb128(ls);
+  if (nproto == 0 || nproto > (LJ_MAX_BUF >> 3) || len == 0 ||
+      len > LJ_MAX_BUF - (nproto << 3))
+    bcread_error(ls, LJ_ERR_BCBAD);
+  /* Frozen input can be used in place, if it's not in the input buffer. */
+  inplace = ls->frozen && sbuflen(&ls->sb) == 0 &&
+	    (MSize)(ls->pe - ls->p) >= (nproto << 2) + len;
+  ud = lj_udata_new(L, (MSize)sizeof(BCIndex) + (nproto << 2) +
+		       (inplace ? 0 : len), tabref(L->env));
+  setudataV(L, L->top, ud);  /* Anchor the dump data while reading. */
+  incr_top(L);
+  bi = (BCIndex *)uddata(ud);
+  bi->flags = bcread_flags(ls);
+  bi->nproto = nproto;
+  bi->len = len;
+  bi->data = (const char *)&bi->ofs[nproto];
+  /* Read and check prototype offsets. */
+  bcread_need(ls, nproto << 2);
+  bcread_block(ls, bi->ofs, nproto << 2);
+  for (i = 0; i < nproto; i++) {
+    MSize ofs = bi->ofs[i];
+    if (bcread_swap(ls)) bi->ofs[i] = ofs = lj_bswap(ofs);
+    if (i ? ofs <= bi->ofs[i-1] : ofs != 0)
+      bcread_error(ls, LJ_ERR_BCBAD);
+  }
+  if (bi->ofs[nproto-1] >= len)
+    bcread_error(ls, LJ_ERR_BCBAD);
+  if (inplace) {
+    bi->data = ls->p;
+    ls->p += len;
+    ls->frozen = 2;  /* The input is in use now. */
+  } else {  /* Copy prototype data, without going through the input buffer. */
+    char *q = (char *)bcindex_data(bi);
+    for (i = 0; i < len; ) {
+      MSize n;
+      if (ls->p == ls->pe) bcread_fill(ls, 1, 1);
+      n = (MSize)(ls->pe - ls->p);
+      if (n > len - i) n = len - i;
+      memcpy(q + i, ls->p, n);
+      ls->p += n;
+      i += n;
+    }
+  }
+  /* Read the main prototype. */
+  p = ls->p; pe = ls->pe;
+  ls->bcindex = ud;
+  pt = bcread_iproto(ls, nproto-1);
+  ls->p = p; ls->pe = pe;
+  /* Check end marker. */
+  bcread_want(ls, 1);
+  if (ls->p == ls->pe || *ls->p++ != 0 || (ls->pe != ls->p && !ls->endmark))
+    bcread_error(ls, LJ_ERR_BCBAD);
+  L->top--;
+  return pt;
+}
+
 /* Read a bytecode dump. */
 GCproto *lj_bcread(LexState *ls)
 {
@@ -424,6 +755,8 @@ GCproto *lj_bcread(LexState *ls)
   /* Check for a valid bytecode dump header. */
   if (!bcread_header(ls))
     bcread_error(ls, LJ_ERR_BCFMT);
+  if ((bcread_flags(ls) & BCDUMP_F_INDEX))
+    return bcread_index(ls);
   for (;;) {  /* Process all prototypes in the bytecode dump. */
     GCproto *pt;
     MSize len;
@@ -451,3 +784,47 @@ GCproto *lj_bcread(LexState *ls)
   return protoV(L->top);
 }
 
+/* Read a lazily loaded prototype and replace its stub in the parent. */
+GCproto *lj_bcread_lazy(lua_State *L, GCproto *parent, GCproto *pt)
+{
+  GCRef *kr = mref(parent->k, GCRef) - (ptrdiff_t)pt->numline;
+  GCudata *ud = gco2ud(proto_kgc(pt, -1));
+  LexState ls;
+  GCproto *npt;
+  lj_assertL(proto_islazy(pt) && gcref(*kr) == obj2gco(pt),
+	     "bad lazy prototype");
+  ls.L = L;
+  ls.c = -1;  /* Never refill the input buffer. */
+  ls.chunkname = proto_chunkname(pt);
+  ls.chunkarg = strdata(ls.chunkname);
+  ls.bcindex = ud;
+  ls.level = ((BCIndex *)uddata(ud))->flags;  /* Dump flags. */
+  npt = bcread_iproto(&ls, pt->firstline);
+  npt->flags |= (pt->flags & PROTO_NOJIT);
+  setgcref(*kr, obj2gco(npt));
+  lj_gc_objbarrier(L, parent, npt);
+  return npt;
+}
+
+/* Fill in a lazily loaded template table. The data was checked before. */
+void lj_bcread_ktab(lua_State *L, GCtab *t)
+{
+  Node *node = noderef(t->node);
+  GCudata *ud = udataV(&node->key);
+  BCIndex *bi = (BCIndex *)uddata(ud);
+  LexState ls;
+  MSize narray, nhash;
+  lj_assertL(tab_islazy(t), "bad lazy template table");
+  ls.L = L;
+  ls.p = bcindex_data(bi) + (MSize)numV(&node->val);
+  ls.pe = bcindex_data(bi) + bi->len;
+  ls.level = bi->flags;  /* Dump flags. */
+  narray = bcread_uleb128(&ls);
+  nhash = bcread_uleb128(&ls);
+  setnilV(&node->val);  /* Drop the stub entry on resize. */
+  setnilV(&node->key);
+  lj_tab_resize(L, t, narray, hsize2hbits(nhash));
+  bcread_ktabfill(&ls, t, narray, nhash);
+  lj_gc_anybarriert(L, t);
+}
+
@@ -27,8 +27,11 @@ typedef struct BCWriteCtx {
   GCproto *pt;			/* Root prototype. */
   lua_Writer wfunc;		/* Writer callback. */
   void *wdata;			/* Writer callback data. */
-  int strip;			/* Strip debug info. */
+  uint32_t flags;		/* BCDUMP_F_STRIP, BCDUMP_F_INDEX, BCDUMP_F_XOPS. */
   int status;			/* Status from writer callback. */
+  SBuf data;			/* Prototypes of an indexed dump. */
+  SBuf ofs;			/* Prototype offsets of an indexed dump. */
+  SBuf kidx;			/* Stack of child prototype numbers. */
 #ifdef LUA_USE_ASSERT
   global_State *g;
 #endif
@@ -132,6 +135,7 @@ static void bcwrite_kgc(BCWriteCtx *ctx, GCproto *pt)
     } else if (o->gch.gct == ~LJ_TPROTO) {
       lj_assertBCW((pt->flags & PROTO_CHILD), "prototype has unexpected child");
       tp = BCDUMP_KGC_CHILD;
+      need = 1+5;
 #if LJ_HASFFI
     } else if (o->gch.gct == ~LJ_TCDATA) {
       CTypeID id = gco2cd(o)->ctypeid;
@@ -158,11 +162,20 @@ static void bcwrite_kgc(BCWriteCtx *ctx, GCproto *pt)
     /* Write constant data (if any). */
     if (tp >= BCDUMP_KGC_STR) {
       p = lj_buf_wmem(p, strdata(gco2str(o)), gco2str(o)->len);
+    } else if (tp == BCDUMP_KGC_CHILD) {
+      if ((ctx->flags & BCDUMP_F_INDEX)) {  /* Pop child number. */
+	uint32_t idx;
+	ctx->kidx.w -= sizeof(uint32_t);
+	memcpy(&idx, ctx->kidx.w, sizeof(uint32_t));
+	p = lj_strfmt_wuleb128(p, idx);
+      }
     } else if (tp == BCDUMP_KGC_TAB) {
+      if (tab_islazy(gco2tab(o)))
+	lj_bcread_ktab(sbufL(&ctx->sb), gco2tab(o));
       bcwrite_ktab(ctx, p, gco2tab(o));
       continue;
 #if LJ_HASFFI
-    } else if (tp != BCDUMP_KGC_CHILD) {
+    } else {
       cTValue *q = (TValue *)cdataptr(gco2cd(o));
       p = lj_strfmt_wuleb128(p, q[0].u32.lo);
       p = lj_strfmt_wuleb128(p, q[0].u32.hi);
@@ -238,6 +251,31 @@ static char *bcwrite_bytecode(BCWriteCtx *ctx, char *p, GCproto *pt)
   return p;
 }
 
+/* Check whether a prototype or any of its children uses extended opcodes. */
+static int bcwrite_isext(BCWriteCtx *ctx, GCproto *pt)
+{
+  const BCIns *bc = proto_bc(pt);
+  MSize i;
+  for (i = 1; i < pt->sizebc; i++)
+    if (bc_isext(bc_op(bc[i])))
+      return 1;
+  if ((pt->flags & PROTO_CHILD)) {
+    ptrdiff_t j, n = pt->sizekgc;
+    GCRef *kr = mref(pt->k, GCRef) - 1;
+    for (j = 0; j < n; j++, kr--) {
+      GCobj *o = gcref(*kr);
+      if (o->gch.gct == ~LJ_TPROTO) {
+	GCproto *cpt = gco2pt(o);
+	if (proto_islazy(cpt))
+	  cpt = lj_bcread_lazy(sbufL(&ctx->sb), pt, cpt);
+	if (bcwrite_isext(ctx, cpt))
+	  return 1;
+      }
+    }
+  }
+  return 0;
+}
+
 /* Write prototype. */
 static void bcwrite_proto(BCWriteCtx *ctx, GCproto *pt)
 {
@@ -250,8 +288,16 @@ static void bcwrite_proto(BCWriteCtx *ctx, GCproto *pt)
     GCRef *kr = mref(pt->k, GCRef) - 1;
     for (i = 0; i < n; i++, kr--) {
       GCobj *o = gcref(*kr);
-      if (o->gch.gct == ~LJ_TPROTO)
-	bcwrite_proto(ctx, gco2pt(o));
+      if (o->gch.gct == ~LJ_TPROTO) {
+	GCproto *cpt = gco2pt(o);
+	if (proto_islazy(cpt))
+	  cpt = lj_bcread_lazy(sbufL(&ctx->sb), pt, cpt);
+	bcwrite_proto(ctx, cpt);
+	if ((ctx->flags & BCDUMP_F_INDEX)) {  /* Push child number. */
+	  uint32_t idx = (sbuflen(&ctx->ofs) >> 2) - 1;
+	  lj_buf_putmem(&ctx->kidx, &idx, sizeof(uint32_t));
+	}
+      }
     }
   }
 
@@ -268,7 +314,7 @@ static void bcwrite_proto(BCWriteCtx *ctx, GCproto *pt)
   p = lj_strfmt_wuleb128(p, pt->sizekgc);
   p = lj_strfmt_wuleb128(p, pt->sizekn);
   p = lj_strfmt_wuleb128(p, pt->sizebc-1);
-  if (!ctx->strip) {
+  if (!(ctx->flags & BCDUMP_F_STRIP)) {
     if (proto_lineinfo(pt))
       sizedbg = pt->sizept - (MSize)((char *)proto_lineinfo(pt) - (char *)pt);
     p = lj_strfmt_wuleb128(p, sizedbg);
@@ -294,14 +340,20 @@ static void bcwrite_proto(BCWriteCtx *ctx, GCproto *pt)
     ctx->sb.w = p;
   }
 
-  /* Pass buffer to writer function. */
+  /* Pass buffer to writer function or collect it for the index. */
   if (ctx->status == 0) {
     MSize n = sbuflen(&ctx->sb) - 5;
     MSize nn = (lj_fls(n)+8)*9 >> 6;
     char *q = ctx->sb.b + (5 - nn);
     p = lj_strfmt_wuleb128(q, n);  /* Fill in final size. */
     lj_assertBCW(p == ctx->sb.b + 5, "bad ULEB128 write");
-    ctx->status = ctx->wfunc(sbufL(&ctx->sb), q, nn+n, ctx->wdata);
+    if ((ctx->flags & BCDUMP_F_INDEX)) {
+      uint32_t ofs = sbuflen(&ctx->data);
+      lj_buf_putmem(&ctx->ofs, &ofs, sizeof(uint32_t));
+      lj_buf_putmem(&ctx->data, q, nn+n);
+    } else {
+      ctx->status = ctx->wfunc(sbufL(&ctx->sb), q, nn+n, ctx->wdata);
+    }
   }
 }
 
@@ -316,11 +368,11 @@ static void bcwrite_header(BCWriteCtx *ctx)
   *p++ = BCDUMP_HEAD2;
   *p++ = BCDUMP_HEAD3;
   *p++ = BCDUMP_VERSION;
-  *p++ = (ctx->strip ? BCDUMP_F_STRIP : 0) +
+  *p++ = (ctx->flags & (BCDUMP_F_STRIP|BCDUMP_F_INDEX|BCDUMP_F_XOPS)) +
 	 LJ_BE*BCDUMP_F_BE +
 	 ((ctx->pt->flags & PROTO_FFI) ? BCDUMP_F_FFI : 0) +
 	 LJ_FR2*BCDUMP_F_FR2;
-  if (!ctx->strip) {
+  if (!(ctx->flags & BCDUMP_F_STRIP)) {
     p = lj_strfmt_wuleb128(p, len);
     p = lj_buf_wmem(p, name, len);
   }
@@ -328,6 +380,22 @@ static void bcwrite_header(BCWriteCtx *ctx)
 			   (MSize)(p - ctx->sb.b), ctx->wdata);
 }
 
+/* Write index and collected prototypes of an indexed bytecode dump. */
+static void bcwrite_index(BCWriteCtx *ctx)
+{
+  lua_State *L = sbufL(&ctx->sb);
+  MSize len = sbuflen(&ctx->data);
+  char *p = lj_buf_need(&ctx->sb, 5+5);
+  p = lj_strfmt_wuleb128(p, sbuflen(&ctx->ofs) >> 2);
+  p = lj_strfmt_wuleb128(p, len);
+  if (ctx->status == 0)
+    ctx->status = ctx->wfunc(L, ctx->sb.b, (MSize)(p - ctx->sb.b), ctx->wdata);
+  if (ctx->status == 0)
+    ctx->status = ctx->wfunc(L, ctx->ofs.b, sbuflen(&ctx->ofs), ctx->wdata);
+  if (ctx->status == 0)
+    ctx->status = ctx->wfunc(L, ctx->data.b, len, ctx->wdata);
+}
+
 /* Write footer of bytecode dump. */
 static void bcwrite_footer(BCWriteCtx *ctx)
 {
@@ -343,29 +411,39 @@ static TValue *cpwriter(lua_State *L, lua_CFunction dummy, void *ud)
   BCWriteCtx *ctx = (BCWriteCtx *)ud;
   UNUSED(L); UNUSED(dummy);
   lj_buf_need(&ctx->sb, 1024);  /* Avoids resize for most prototypes. */
+  if (bcwrite_isext(ctx, ctx->pt))
+    ctx->flags |= BCDUMP_F_XOPS;
   bcwrite_header(ctx);
   bcwrite_proto(ctx, ctx->pt);
+  if ((ctx->flags & BCDUMP_F_INDEX))
+    bcwrite_index(ctx);
   bcwrite_footer(ctx);
   return NULL;
 }
 
 /* Write bytecode for a prototype. */
 int lj_bcwrite(lua_State *L, GCproto *pt, lua_Writer writer, void *data,
-	      int strip)
+	      uint32_t flags)
 {
   BCWriteCtx ctx;
   int status;
   ctx.pt = pt;
   ctx.wfunc = writer;
   ctx.wdata = data;
-  ctx.strip = strip;
+  ctx.flags = flags;
   ctx.status = 0;
 #ifdef LUA_USE_ASSERT
   ctx.g = G(L);
 #endif
   lj_buf_init(L, &ctx.sb);
+  lj_buf_init(L, &ctx.data);
+  lj_buf_init(L, &ctx.ofs);
+  lj_buf_init(L, &ctx.kidx);
   status = lj_vm_cpcall(L, NULL, &ctx, cpwriter);
   if (status == 0) status = ctx.status;
+  lj_buf_free(G(L), &ctx.kidx);
+  lj_buf_free(G(L), &ctx.ofs);
+  lj_buf_free(G(L), &ctx.data);
   lj_buf_free(G(sbufL(&ctx.sb)), &ctx.sb);
   return status;
 }
@@ -243,6 +243,7 @@ SBuf *lj_buf_putstr_rep(SBuf *sb, GCstr *s, int32_t rep)
 SBuf *lj_buf_puttab(SBuf *sb, GCtab *t, GCstr *sep, int32_t i, int32_t e)
 {
   MSize seplen = sep ? sep->len : 0;
+  SFormat sf = STRFMT_TOSTR(G(sbufL(sb)));
   if (i <= e) {
     for (;;) {
       cTValue *o = lj_tab_getint(t, i);
@@ -257,7 +258,7 @@ SBuf *lj_buf_puttab(SBuf *sb, GCtab *t, GCstr *sep, int32_t i, int32_t e)
       } else if (tvisint(o)) {
 	w = lj_strfmt_wint(lj_buf_more(sb, STRFMT_MAXBUF_INT+seplen), intV(o));
       } else if (tvisnum(o)) {
-	w = lj_buf_more(lj_strfmt_putfnum(sb, STRFMT_G14, numV(o)), seplen);
+	w = lj_buf_more(lj_strfmt_putfnum(sb, sf, numV(o)), seplen);
       } else {
 	goto badtype;
       }
@@ -272,6 +272,9 @@ restart:
       case BC_GGET:
 	*name = strdata(gco2str(proto_kgc(pt, ~(ptrdiff_t)bc_d(ins))));
 	return "global";
+      case BC_GGETX:
+	*name = strdata(gco2str(proto_kgc(pt, ~(ptrdiff_t)bc_dx(ip))));
+	return "global";
       case BC_TGETS:
 	*name = strdata(gco2str(proto_kgc(pt, ~(ptrdiff_t)bc_c(ins))));
 	if (ip > proto_bc(pt)) {
@@ -312,6 +312,23 @@ int luaJIT_setmode(lua_State *L, int idx, int mode)
       g->bc_cfunc_ext = BCINS_AD(BC_FUNCC, 0, 0);
     }
     break;
+  case LUAJIT_MODE_NUMFMT:
+    g->str.numfmt = (mode & LUAJIT_MODE_ON) ? 1 : 0;
+    lj_trace_flushall(L);  /* Traces may hold constant-folded conversions. */
+    break;
+  case LUAJIT_MODE_TABCOW:
+    if (!LJ_HASTABCOW && (mode & LUAJIT_MODE_ON))
+      return 0;  /* Failed. */
+    g->tabcow = (mode & LUAJIT_MODE_ON) ? (TABCOW_ON|TABCOW_USED) :
+		(g->tabcow & TABCOW_USED);
+    lj_trace_flushall(L);  /* Traces only check stores if shared tables exist. */
+    break;
+  case LUAJIT_MODE_CTORMULTI:
+    g->ctormulti = (mode & LUAJIT_MODE_ON) ? 1 : 0;  /* Affects the parser only. */
+    break;
+  case LUAJIT_MODE_TABSHRINK:
+    g->tabshrink = (mode & LUAJIT_MODE_ON) ? 1 : 0;
+    break;
   default:
     return 0;  /* Failed. */
   }
@@ -394,7 +411,7 @@ static BCReg cur_topslot(GCproto *pt, const BCIns *pc, uint32_t nres)
   switch (bc_op(ins)) {
   case BC_CALLM: case BC_CALLMT: return bc_a(ins) + bc_c(ins) + nres-1+1+LJ_FR2;
   case BC_RETM: return bc_a(ins) + bc_d(ins) + nres-1;
-  case BC_TSETM: return bc_a(ins) + nres-1;
+  case BC_TSETM: case BC_TSTML: case BC_TSETMR: return bc_a(ins) + nres-1;
   default: return pt->framesize;
   }
 }
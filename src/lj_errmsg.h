@@ -80,6 +80,8 @@ ERRDEF(CORUN,	"cannot resume running coroutine")
 ERRDEF(CODEAD,	"cannot resume dead coroutine")
 ERRDEF(COSUSP,	"cannot resume non-suspended coroutine")
 ERRDEF(TABINS,	"wrong number of arguments to " LUA_QL("insert"))
+ERRDEF(TABMOV,	"too many elements to move")
+ERRDEF(TABORD,	"NYI: ordered tables on this platform")
 ERRDEF(TABCAT,	"invalid value (%s) at index %d in table for " LUA_QL("concat"))
 ERRDEF(TABSORT,	"invalid order function for sorting")
 ERRDEF(IOCLFL,	"attempt to use a closed file")
@@ -135,6 +137,7 @@ ERRDEF(XAMBIG,	"ambiguous syntax (function call x new statement)")
 #endif
 ERRDEF(XFUNARG,	"function arguments expected")
 ERRDEF(XSYMBOL,	"unexpected symbol")
+ERRDEF(XDATA,	"constant data expected")
 ERRDEF(XDOTS,	"cannot use " LUA_QL("...") " outside a vararg function")
 ERRDEF(XSYNTAX,	"syntax error")
 ERRDEF(XFOR,	LUA_QL("=") " or " LUA_QL("in") " expected")
@@ -156,7 +156,8 @@ static void LJ_FASTCALL recff_nyi(jit_State *J, RecordFFData *rd)
       BCOp op = bc_op(*frame_pc(J->L->base-1));
       /* Stitched trace cannot start with *M op with variable # of args. */
       if (!(op == BC_CALLM || op == BC_CALLMT ||
-	    op == BC_RETM || op == BC_TSETM)) {
+	    op == BC_RETM || op == BC_TSETM || op == BC_TSTML ||
+	    op == BC_TSETMR)) {
 	switch (J->fn->c.ffid) {
 	case FF_error:
 	case FF_debug_sethook:
@@ -1454,11 +1455,45 @@ static void LJ_FASTCALL recff_table_clear(jit_State *J, RecordFFData *rd)
   TRef tr = J->base[0];
   if (tref_istab(tr)) {
     rd->nres = 0;
+    lj_record_nocow(J, tr, tabV(&rd->argv[0]));
     lj_ir_call(J, IRCALL_lj_tab_clear, tr);
     J->needsnap = 1;
   }  /* else: Interpreter will throw. */
 }
 
+static void LJ_FASTCALL recff_table_move(jit_State *J, RecordFFData *rd)
+{
+  TRef src = J->base[0];
+  TRef dst = (J->base[3] && J->base[4] && !tref_isnil(J->base[4])) ?
+	     J->base[4] : src;
+  if (tref_istab(src) && tref_istab(dst) && J->base[3]) {
+    GCtab *ts = tabV(&rd->argv[0]);
+    GCtab *td = dst == src ? ts : tabV(&rd->argv[4]);
+    TRef trf, tre, trt, tmp;
+    if (tabref(ts->metatable) || tabref(td->metatable)) {
+      recff_nyiu(J, rd);  /* Metamethods may be called per element. */
+      return;
+    }
+    trf = lj_opt_narrow_toint(J, J->base[1]);
+    tre = lj_opt_narrow_toint(J, J->base[2]);
+    trt = lj_opt_narrow_toint(J, J->base[3]);
+    /* Same range checks as the interpreter, but exit on any overflow. */
+    tmp = emitir(IRTGI(IR_SUBOV), tre, trf);
+    emitir(IRTGI(IR_NE), tmp, lj_ir_kint(J, 0x7fffffff));
+    emitir(IRTGI(IR_ADDOV), trt, tmp);
+    tmp = emitir(IRT(IR_FLOAD, IRT_TAB), src, IRFL_TAB_META);
+    emitir(IRTG(IR_EQ, IRT_TAB), tmp, lj_ir_knull(J, IRT_TAB));
+    if (dst != src) {
+      tmp = emitir(IRT(IR_FLOAD, IRT_TAB), dst, IRFL_TAB_META);
+      emitir(IRTG(IR_EQ, IRT_TAB), tmp, lj_ir_knull(J, IRT_TAB));
+    }
+    lj_record_nocow(J, dst, td);
+    lj_ir_call(J, IRCALL_lj_tab_move, src, trf, tre, trt, dst);
+    J->base[0] = dst;
+    J->needsnap = 1;
+  }  /* else: Interpreter will throw. */
+}
+
 /* -- I/O library fast functions ------------------------------------------ */
 
 /* Get FILE* for I/O function. Any I/O error aborts recording, so there's
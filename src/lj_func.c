@@ -13,6 +13,7 @@
 #include "lj_gc.h"
 #include "lj_func.h"
 #include "lj_trace.h"
+#include "lj_bcdump.h"
 #include "lj_vm.h"
 
 /* -- Prototypes ---------------------------------------------------------- */
@@ -161,6 +162,10 @@ GCfunc *lj_func_newL_gc(lua_State *L, GCproto *pt, GCfuncL *parent)
   MSize i, nuv;
   TValue *base;
   lj_gc_check_fixtop(L);
+  if (LJ_UNLIKELY(proto_islazy(pt))) {  /* Read on first instantiation. */
+    L->top = curr_topL(L);
+    pt = lj_bcread_lazy(L, funcproto((GCfunc *)parent), pt);
+  }
   fn = func_newL(L, pt, tabref(parent->env));
   /* NOBARRIER: The GCfunc is new (marked white). */
   puv = parent->uvptr;
@@ -169,6 +169,17 @@ size_t lj_gc_separateudata(global_State *g, int all)
 
 /* -- Propagation phase --------------------------------------------------- */
 
+/* Let the next new key rehash a large hash part with few live keys left.
+** Resizing here would break a running traversal, see lj_tab_newkey().
+*/
+static void gc_shrinktab(GCtab *t, MSize live)
+{
+  if (t->hmask >= LJ_TAB_SHRINKMIN-1 && live < (t->hmask+1) >> 2) {
+    Node *node = noderef(t->node);
+    setfreetop(t, node, node);
+  }
+}
+
 /* Traverse a table. */
 static int gc_traverse_tab(global_State *g, GCtab *t)
 {
@@ -177,6 +188,12 @@ static int gc_traverse_tab(global_State *g, GCtab *t)
   GCtab *mt = tabref(t->metatable);
   if (mt)
     gc_markobj(g, mt);
+#if LJ_HASTABCOW
+  if (tab_iscow(t)) {  /* Shared storage is traversed with the backing table. */
+    gc_markobj(g, tab_cowref(t));
+    return 0;
+  }
+#endif
   mode = lj_meta_fastg(g, mt, MM_mode);
   if (mode && tvisstr(mode)) {  /* Valid __mode field? */
     const char *modestr = strVdata(mode);
@@ -208,15 +225,18 @@ static int gc_traverse_tab(global_State *g, GCtab *t)
   }
   if (t->hmask > 0) {  /* Mark hash part. */
     Node *node = noderef(t->node);
-    MSize i, hmask = t->hmask;
+    MSize i, hmask = t->hmask, live = 0;
     for (i = 0; i <= hmask; i++) {
       Node *n = &node[i];
       if (!tvisnil(&n->val)) {  /* Mark non-empty slot. */
 	lj_assertG(!tvisnil(&n->key), "mark of nil key in non-empty slot");
 	if (!(weak & LJ_GC_WEAKKEY)) gc_marktv(g, &n->key);
 	if (!(weak & LJ_GC_WEAKVAL)) gc_marktv(g, &n->val);
+	live++;
       }
     }
+    if (g->tabshrink && !weak)  /* Weak tables are checked after clearing. */
+      gc_shrinktab(t, live);
   }
   return weak;
 }
@@ -332,6 +352,8 @@ static size_t propagatemark(global_State *g)
     GCtab *t = gco2tab(o);
     if (gc_traverse_tab(g, t) > 0)
       black2gray(o);  /* Keep weak tables gray. */
+    if (tab_iscow(t))
+      return sizeof(GCtab);
     return sizeof(GCtab) + sizeof(TValue) * t->asize +
 			   (t->hmask ? sizeof(Node) * (t->hmask + 1) : 0);
   } else if (LJ_LIKELY(gct == ~LJ_TFUNC)) {
@@ -472,7 +494,6 @@ static int gc_mayclear(cTValue *o, int val)
 /* Clear collected entries from weak tables. */
 static void gc_clearweak(global_State *g, GCobj *o)
 {
-  UNUSED(g);
   while (o) {
     GCtab *t = gco2tab(o);
     lj_assertG((t->marked & LJ_GC_WEAK), "clear of non-weak table");
@@ -487,14 +508,19 @@ static void gc_clearweak(global_State *g, GCobj *o)
     }
     if (t->hmask > 0) {
       Node *node = noderef(t->node);
-      MSize i, hmask = t->hmask;
+      MSize i, hmask = t->hmask, live = 0;
       for (i = 0; i <= hmask; i++) {
 	Node *n = &node[i];
 	/* Clear hash slot when key or value is about to be collected. */
-	if (!tvisnil(&n->val) && (gc_mayclear(&n->key, 0) ||
-				  gc_mayclear(&n->val, 1)))
-	  setnilV(&n->val);
+	if (!tvisnil(&n->val)) {
+	  if (gc_mayclear(&n->key, 0) || gc_mayclear(&n->val, 1))
+	    setnilV(&n->val);
+	  else
+	    live++;
+	}
       }
+      if (g->tabshrink)
+	gc_shrinktab(t, live);
     }
     o = gcref(t->gclist);
   }
@@ -735,6 +761,7 @@ int LJ_FASTCALL lj_gc_step(lua_State *L)
   GCSize lim;
   int32_t ostate = g->vmstate;
   setvmstate(g, GC);
+  g->gc.nstep++;
   lim = (GCSTEPSIZE/100) * g->gc.stepmul;
   if (lim == 0)
     lim = LJ_MAX_MEM;
@@ -744,6 +771,7 @@ int LJ_FASTCALL lj_gc_step(lua_State *L)
     lim -= (GCSize)gc_onestep(L);
     if (g->gc.state == GCSpause) {
       g->gc.threshold = (g->gc.estimate/100) * g->gc.pause;
+      g->gc.ncycle++;
       g->vmstate = ostate;
       return 1;  /* Finished a GC cycle. */
     }
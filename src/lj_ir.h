@@ -119,7 +119,7 @@
   _(SNEW,	N , ref, ref)  /* CSE is ok, not marked as A. */ \
   _(XSNEW,	A , ref, ref) \
   _(TNEW,	AW, lit, lit) \
-  _(TDUP,	AW, ref, ___) \
+  _(TDUP,	AW, ref, lit) \
   _(CNEW,	AW, ref, ref) \
   _(CNEWI,	NW, ref, ref)  /* CSE is ok, not marked as A. */ \
   \
@@ -202,6 +202,7 @@ IRFPMDEF(FPMENUM)
   _(TAB_ASIZE,	offsetof(GCtab, asize)) \
   _(TAB_HMASK,	offsetof(GCtab, hmask)) \
   _(TAB_NOMM,	offsetof(GCtab, nomm)) \
+  _(TAB_MARKED,	offsetof(GCtab, marked)) \
   _(UDATA_META,	offsetof(GCudata, metatable)) \
   _(UDATA_UDTYPE, offsetof(GCudata, udtype)) \
   _(UDATA_FILE,	sizeof(GCudata)) \
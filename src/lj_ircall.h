@@ -113,6 +113,12 @@ typedef struct CCallInfo {
 #define IRCALLCOND_FFI32(x)		NULL
 #endif
 
+#if LJ_GC64
+#define IRCALLCOND_GC64(x)		x
+#else
+#define IRCALLCOND_GC64(x)		NULL
+#endif
+
 #if LJ_HASBUFFER
 #define IRCALLCOND_BUFFER(x)		x
 #else
@@ -185,7 +191,10 @@ typedef struct CCallInfo {
   _(ANY,	lj_tab_new_ah,		3,   A, TAB, CCI_L|CCI_T) \
   _(ANY,	lj_tab_new1,		2,  FA, TAB, CCI_L|CCI_T) \
   _(ANY,	lj_tab_dup,		2,  FA, TAB, CCI_L|CCI_T) \
+  _(ANY,	lj_tab_dupcow,		2,  FA, TAB, CCI_L|CCI_T) \
   _(ANY,	lj_tab_clear,		1,  FS, NIL, 0) \
+  _(ANY,	lj_tab_move,		6,   S, NIL, CCI_L|CCI_T) \
+  _(GC64,	lj_tab_unshare,		2,  FS, NIL, CCI_L|CCI_T) \
   _(ANY,	lj_tab_newkey,		3,   S, PGC, CCI_L|CCI_T) \
   _(ANY,	lj_tab_keyindex,	2,  FL, INT, 0) \
   _(ANY,	lj_vm_next,		2,  FL, PTR, 0) \
@@ -27,6 +27,15 @@
 #include "lj_strscan.h"
 #include "lj_strfmt.h"
 
+#if LJ_TARGET_X86ORX64 && (defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define LEX_SSE2	1
+#elif LJ_TARGET_ARM64
+#include <arm_neon.h>
+#define LEX_NEON	1
+#endif
+
 /* Lua lexer token names. */
 static const char *const tokennames[] = {
 #define TKSTR1(name)		#name,
@@ -78,6 +87,63 @@ static LJ_AINLINE LexChar lex_savenext(LexState *ls)
   return lex_next(ls);
 }
 
+/* Find the first of the chars a, b, c or d in the buffer span [p, pe). */
+static const char *lex_find(const char *p, const char *pe,
+			    int a, int b, int c, int d)
+{
+#if LEX_SSE2
+  __m128i va = _mm_set1_epi8((char)a), vb = _mm_set1_epi8((char)b);
+  __m128i vc = _mm_set1_epi8((char)c), vd = _mm_set1_epi8((char)d);
+  while (pe - p >= 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *)p);
+    __m128i m = _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(x, va), _mm_cmpeq_epi8(x, vb)),
+      _mm_or_si128(_mm_cmpeq_epi8(x, vc), _mm_cmpeq_epi8(x, vd)));
+    uint32_t mask = (uint32_t)_mm_movemask_epi8(m);
+    if (mask) return p + lj_ffs(mask);
+    p += 16;
+  }
+#elif LEX_NEON
+  uint8x16_t va = vdupq_n_u8((uint8_t)a), vb = vdupq_n_u8((uint8_t)b);
+  uint8x16_t vc = vdupq_n_u8((uint8_t)c), vd = vdupq_n_u8((uint8_t)d);
+  while (pe - p >= 16) {
+    uint8x16_t x = vld1q_u8((const uint8_t *)p);
+    uint8x16_t m = vorrq_u8(vorrq_u8(vceqq_u8(x, va), vceqq_u8(x, vb)),
+			    vorrq_u8(vceqq_u8(x, vc), vceqq_u8(x, vd)));
+    if (vmaxvq_u8(m)) break;  /* The scalar loop finds the exact position. */
+    p += 16;
+  }
+#endif
+  for (; p < pe; p++) {
+    int ch = (uint8_t)*p;
+    if (ch == a || ch == b || ch == c || ch == d) break;
+  }
+  return p;
+}
+
+/* Skip (and save, unless sb is NULL) the current char and all following
+** chars in the buffer up to one of a, b, c or d. Then get next character.
+** The current char must come from the buffer and must not be a stop char.
+*/
+static void lex_span(LexState *ls, SBuf *sb, int a, int b, int c, int d)
+{
+  const char *p = ls->p - 1;
+  const char *q = lex_find(ls->p, ls->pe, a, b, c, d);
+  if (sb) lj_buf_putmem(sb, p, (MSize)(q - p));
+  ls->p = q;
+  lex_next(ls);
+}
+
+/* Save the current char and all following identifier chars in the buffer. */
+static void lex_spanident(LexState *ls)
+{
+  const char *p = ls->p - 1, *q = ls->p, *pe = ls->pe;
+  while (q < pe && lj_char_isident((uint8_t)*q)) q++;
+  lj_buf_putmem(&ls->sb, p, (MSize)(q - p));
+  ls->p = q;
+  lex_next(ls);
+}
+
 /* Skip line break. Handles "\n", "\r", "\r\n" or "\n\r". */
 static void lex_newline(LexState *ls)
 {
@@ -96,18 +162,36 @@ static void lex_number(LexState *ls, TValue *tv)
 {
   StrScanFmt fmt;
   LexChar c, xp = 'e';
+  const char *p = ls->p - 1, *q = ls->p, *pe = ls->pe;
+  uint32_t opt = (LJ_DUALNUM ? STRSCAN_OPT_TOINT : STRSCAN_OPT_TONUM) |
+		 (LJ_HASFFI ? (STRSCAN_OPT_LL|STRSCAN_OPT_IMAG) : 0);
   lj_assertLS(lj_char_isdigit(ls->c), "bad usage");
-  if ((c = ls->c) == '0' && (lex_savenext(ls) | 0x20) == 'x')
+  if (*p == '0' && q < pe && (*q | 0x20) == 'x')
     xp = 'p';
-  while (lj_char_isident(ls->c) || ls->c == '.' ||
-	 ((ls->c == '-' || ls->c == '+') && (c | 0x20) == xp)) {
-    c = ls->c;
-    lex_savenext(ls);
+  while (q < pe && (lj_char_isident((uint8_t)*q) || *q == '.' ||
+	 ((*q == '-' || *q == '+') && (q[-1] | 0x20) == xp)))
+    q++;
+  if (q < pe && sbuflen(&ls->sb) == 0) {
+    /* The terminator is in the buffer, too, and no leading '.' was saved
+    ** by lex_scan(). Scan the literal in-place.
+    */
+    lj_buf_putmem(&ls->sb, p, (MSize)(q - p));  /* Only for error messages. */
+    ls->p = q;
+    lex_next(ls);
+    fmt = lj_strscan_scan((const uint8_t *)p, (MSize)(q - p), tv, opt);
+  } else {
+    xp = 'e';
+    if ((c = ls->c) == '0' && (lex_savenext(ls) | 0x20) == 'x')
+      xp = 'p';
+    while (lj_char_isident(ls->c) || ls->c == '.' ||
+	   ((ls->c == '-' || ls->c == '+') && (c | 0x20) == xp)) {
+      c = ls->c;
+      lex_savenext(ls);
+    }
+    lex_save(ls, '\0');
+    fmt = lj_strscan_scan((const uint8_t *)ls->sb.b, sbuflen(&ls->sb)-1, tv,
+			  opt);
   }
-  lex_save(ls, '\0');
-  fmt = lj_strscan_scan((const uint8_t *)ls->sb.b, sbuflen(&ls->sb)-1, tv,
-	  (LJ_DUALNUM ? STRSCAN_OPT_TOINT : STRSCAN_OPT_TONUM) |
-	  (LJ_HASFFI ? (STRSCAN_OPT_LL|STRSCAN_OPT_IMAG) : 0));
   if (LJ_DUALNUM && fmt == STRSCAN_INT) {
     setitype(tv, LJ_TISNUM);
   } else if (fmt == STRSCAN_NUM) {
@@ -171,7 +255,7 @@ static void lex_longstring(LexState *ls, TValue *tv, int sep)
       if (!tv) lj_buf_reset(&ls->sb);  /* Don't waste space for comments. */
       break;
     default:
-      lex_savenext(ls);
+      lex_span(ls, tv ? &ls->sb : NULL, ']', '\n', '\r', ']');
       break;
     }
   } endloop:
@@ -276,7 +360,7 @@ static void lex_string(LexState *ls, TValue *tv)
       continue;
       }
     default:
-      lex_savenext(ls);
+      lex_span(ls, &ls->sb, (int)delim, '\\', '\n', '\r');
       break;
     }
   }
@@ -300,7 +384,7 @@ static LexToken lex_scan(LexState *ls, TValue *tv)
       }
       /* Identifier or reserved word. */
       do {
-	lex_savenext(ls);
+	lex_spanident(ls);
       } while (lj_char_isident(ls->c));
       s = lj_parse_keepstr(ls, ls->sb.b, sbuflen(&ls->sb));
       setstrV(ls->L, tv, s);
@@ -334,7 +418,7 @@ static LexToken lex_scan(LexState *ls, TValue *tv)
       }
       /* Short comment "--.*\n". */
       while (!lex_iseol(ls) && ls->c != LEX_EOF)
-	lex_next(ls);
+	lex_span(ls, NULL, '\n', '\r', '\n', '\r');
       continue;
     case '[': {
       int sep = lex_skipeq(ls);
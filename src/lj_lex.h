@@ -72,8 +72,11 @@ typedef struct LexState {
   MSize vtop;		/* Top of variable stack. */
   BCInsLine *bcstack;	/* Stack for bytecode instructions/line numbers. */
   MSize sizebcstack;	/* Size of bytecode stack. */
+  GCtab *ktab;		/* Template tables of the chunk, keyed by content. */
+  GCudata *bcindex;	/* Retained data of an indexed bytecode dump. */
   uint32_t level;	/* Syntactical nesting level. */
   int endmark;		/* Trust bytecode end marker, even if not at EOF. */
+  int frozen;		/* Input is never changed or freed (1), or in use (2). */
 } LexState;
 
 LJ_FUNC int lj_lex_setup(lua_State *L, LexState *ls);
@@ -49,9 +49,10 @@ static GCtab *lib_create_table(lua_State *L, const char *libname, int hsize)
   return tabV(L->top-1);
 }
 
-static const uint8_t *lib_read_lfunc(lua_State *L, const uint8_t *p, GCtab *tab)
+static const uint8_t *lib_read_lfunc(lua_State *L, const uint8_t *p, GCtab *tab,
+				     GCfunc **fnp)
 {
-  int len = *p++;
+  int tag = *p++, len = tag & LIBINIT_LENMASK;
   GCstr *name = lj_str_new(L, (const char *)p, len);
   LexState ls;
   GCproto *pt;
@@ -66,8 +67,11 @@ static const uint8_t *lib_read_lfunc(lua_State *L, const uint8_t *p, GCtab *tab)
   pt = lj_bcread_proto(&ls);
   pt->firstline = ~(BCLine)0;
   fn = lj_func_newL_empty(L, pt, tabref(L->env));
-  /* NOBARRIER: See below for common barrier. */
-  setfuncV(L, lj_tab_setstr(L, tab, name), fn);
+  if (!(tag & LIBINIT_NOREG)) {  /* NOBARRIER: See below for common barrier. */
+    setfuncV(L, lj_tab_setstr(L, tab, name), fn);
+  } else {  /* An unregistered function can only be pushed as an upvalue. */
+    *fnp = fn;
+  }
   return (const uint8_t *)ls.p;
 }
 
@@ -116,7 +120,7 @@ void lj_lib_register(lua_State *L, const char *libname,
     } else {
       switch (tag | len) {
       case LIBINIT_LUA:
-	p = lib_read_lfunc(L, p, tab);
+	p = lib_read_lfunc(L, p, tab, &ofn);
 	break;
       case LIBINIT_SET:
 	L->top -= 2;
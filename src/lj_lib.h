@@ -105,6 +105,7 @@ LJ_FUNC int lj_lib_postreg(lua_State *L, lua_CFunction cf, int id,
 #define LIBINIT_ASM_	0x80
 #define LIBINIT_STRING	0xc0
 #define LIBINIT_MAXSTR	0x38
+#define LIBINIT_NOREG	0x80	/* Flag in the name length of LIBINIT_LUA. */
 #define LIBINIT_LUA	0xf9
 #define LIBINIT_SET	0xfa
 #define LIBINIT_NUMBER	0xfb
@@ -23,6 +23,29 @@
 #include "lj_bcdump.h"
 #include "lj_parse.h"
 
+#if LJ_TARGET_WINDOWS && !LJ_TARGET_UWP
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#define LJ_HASFILEMAP	1
+#elif LJ_TARGET_POSIX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define LJ_HASFILEMAP	1
+#else
+#define LJ_HASFILEMAP	0
+#endif
+
+#if LJ_TARGET_WINDOWS && !LJ_TARGET_UWP
+#define LJ_HASLOADTHREADS	1
+#elif LJ_TARGET_POSIX && !LJ_TARGET_CONSOLE
+#include <pthread.h>
+#define LJ_HASLOADTHREADS	1
+#else
+#define LJ_HASLOADTHREADS	0
+#endif
+
 /* -- Load Lua source code and bytecode ----------------------------------- */
 
 static TValue *cpparser(lua_State *L, lua_CFunction dummy, void *ud)
@@ -34,6 +57,10 @@ static TValue *cpparser(lua_State *L, lua_CFunction dummy, void *ud)
   UNUSED(dummy);
   cframe_errfunc(L->cframe) = -1;  /* Inherit error function. */
   bc = lj_lex_setup(L, ls);
+  if (!bc && ls->mode && strchr(ls->mode, 'd')) {  /* Pure data chunk. */
+    lj_parse_data(ls);
+    return NULL;
+  }
   if (ls->mode && !strchr(ls->mode, bc ? 'b' : 't')) {
     setstrV(L, L->top++, lj_err_str(L, LJ_ERR_XMODE));
     lj_err_throw(L, LUA_ERRSYNTAX);
@@ -45,23 +72,47 @@ static TValue *cpparser(lua_State *L, lua_CFunction dummy, void *ud)
   return NULL;
 }
 
-LUA_API int lua_loadx(lua_State *L, lua_Reader reader, void *data,
-		      const char *chunkname, const char *mode)
+/* Load a chunk. *frozen is 1 for frozen input and set to 2 if it's in use. */
+static int load_chunk(lua_State *L, lua_Reader reader, void *data,
+		      const char *chunkname, const char *mode, int *frozen)
 {
+  global_State *g = G(L);
   LexState ls;
+  GCSize threshold = g->gc.threshold;
+  uint32_t nstep = g->gc.nstep, ncycle = g->gc.ncycle;
   int status;
+  /* Defer GC steps up to the load limit, unless the GC is stopped. A step
+  ** during a load mostly retraverses the growing constant and template
+  ** tables of the parser. Once the limit is hit, steps run as usual.
+  */
+  if (g->gc.loadlimit > threshold && threshold != LJ_MAX_MEM)
+    g->gc.threshold = g->gc.loadlimit;
   ls.rfunc = reader;
   ls.rdata = data;
   ls.chunkarg = chunkname ? chunkname : "?";
   ls.mode = mode;
+  ls.frozen = frozen ? *frozen : 0;
   lj_buf_init(L, &ls.sb);
   status = lj_vm_cpcall(L, NULL, &ls, cpparser);
   lj_lex_cleanup(L, &ls);
+  if (g->gc.nstep == nstep)  /* Restore, so the GC catches up in steps. */
+    g->gc.threshold = threshold;
+  g->gc.loadnum++;
+  g->gc.loadstep += g->gc.nstep - nstep;
+  g->gc.loadcycle += g->gc.ncycle - ncycle;
+  if (g->gc.total > g->gc.loadpeak) g->gc.loadpeak = g->gc.total;
   lj_gc_check(L);
   //lua_print_func_bc(L); // >xpk< uncomment to dump all loaded functions
+  if (frozen) *frozen = ls.frozen;
   return status;
 }
 
+LUA_API int lua_loadx(lua_State *L, lua_Reader reader, void *data,
+		      const char *chunkname, const char *mode)
+{
+  return load_chunk(L, reader, data, chunkname, mode, NULL);
+}
+
 LUA_API int lua_load(lua_State *L, lua_Reader reader, void *data,
 		     const char *chunkname)
 {
@@ -82,6 +133,8 @@ static const char *reader_file(lua_State *L, void *ud, size_t *size)
   return *size > 0 ? ctx->buf : NULL;
 }
 
+static int cache_load(lua_State *L, const char *filename, const char *mode);
+
 LUALIB_API int luaL_loadfilex(lua_State *L, const char *filename,
 			      const char *mode)
 {
@@ -89,6 +142,8 @@ LUALIB_API int luaL_loadfilex(lua_State *L, const char *filename,
   int status;
   const char *chunkname;
   if (filename) {
+    if ((status = cache_load(L, filename, mode)) >= 0)
+      return status;
     ctx.fp = fopen(filename, "rb");
     if (ctx.fp == NULL) {
       lua_pushfstring(L, "cannot open %s: %s", filename, strerror(errno));
@@ -155,6 +210,536 @@ LUALIB_API int luaL_loadstring(lua_State *L, const char *s)
   return luaL_loadbuffer(L, s, strlen(s), s);
 }
 
+/* Like luaL_loadbuffer, but the buffer must never be changed or freed while
+** the state exists. The prototype data of an indexed bytecode dump is then
+** used in place, so all states which load the same buffer share it.
+*/
+LUALIB_API int luaL_loadbufferfrozen(lua_State *L, const char *buf,
+				     size_t size, const char *name)
+{
+  StringReaderCtx ctx;
+  int frozen = 1;
+  ctx.str = buf;
+  ctx.size = size;
+  return load_chunk(L, reader_string, &ctx, name, NULL, &frozen);
+}
+
+/* -- Load from a memory-mapped file -------------------------------------- */
+
+#if LJ_HASFILEMAP
+
+/* Map a whole regular file read-only. Returns NULL if that's not possible. */
+static const char *filemap_open(const char *filename, size_t *size)
+{
+#if LJ_TARGET_WINDOWS
+  HANDLE fh, mh;
+  LARGE_INTEGER sz;
+  void *p = NULL;
+  fh = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+		   OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (fh == INVALID_HANDLE_VALUE)
+    return NULL;
+  if (GetFileSizeEx(fh, &sz) && sz.QuadPart > 0 &&
+      (uint64_t)sz.QuadPart <= (uint64_t)(~(size_t)0 >> 1)) {
+    mh = CreateFileMappingA(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mh) {
+      p = MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0);
+      CloseHandle(mh);  /* The view keeps the mapping alive. */
+      *size = (size_t)sz.QuadPart;
+    }
+  }
+  CloseHandle(fh);
+  return (const char *)p;
+#else
+  struct stat st;
+  void *p = NULL;
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 &&
+      (uint64_t)st.st_size <= (uint64_t)(~(size_t)0 >> 1)) {
+    p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+      p = NULL;
+    } else {
+#ifdef MADV_SEQUENTIAL
+      madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+      *size = (size_t)st.st_size;
+    }
+  }
+  close(fd);
+  return (const char *)p;
+#endif
+}
+
+static void filemap_close(const char *p, size_t size)
+{
+#if LJ_TARGET_WINDOWS
+  UNUSED(size);
+  UnmapViewOfFile(p);
+#else
+  munmap((void *)p, size);
+#endif
+}
+
+#endif
+
+/* Like luaL_loadfilex, but hands the whole file to the lexer as one span. */
+LUALIB_API int luaL_loadfilemapx(lua_State *L, const char *filename,
+				 const char *mode)
+{
+#if LJ_HASFILEMAP
+  StringReaderCtx ctx;
+  int status;
+  if (filename && (status = cache_load(L, filename, mode)) >= 0)
+    return status;
+  if (filename && (ctx.str = filemap_open(filename, &ctx.size)) != NULL) {
+    const char *p = ctx.str;
+    size_t size = ctx.size;
+    const char *chunkname = lua_pushfstring(L, "@%s", filename);
+    status = lua_loadx(L, reader_string, &ctx, chunkname, mode);
+    filemap_close(p, size);
+    L->top--;
+    copyTV(L, L->top-1, L->top);
+    return status;
+  }
+#endif
+  /* Fallback for stdin, pipes, empty files or no mmap support. */
+  return luaL_loadfilex(L, filename, mode);
+}
+
+LUALIB_API int luaL_loadfilemap(lua_State *L, const char *filename)
+{
+  return luaL_loadfilemapx(L, filename, NULL);
+}
+
+#if LJ_HASFILEMAP
+/* A file kept mapped for frozen input until the state is closed. */
+typedef struct FileMap {
+  const char *p;
+  size_t size;
+  struct FileMap *next;
+} FileMap;
+
+/* Load a mapped file as frozen input. The mapping is closed, unless the
+** chunk uses it in place. Then it's kept until the state is closed.
+*/
+static int filemap_loadfrozen(lua_State *L, const char *p, size_t size,
+			      const char *chunkname, const char *mode)
+{
+  StringReaderCtx ctx;
+  FileMap *fm = lj_mem_newt(L, sizeof(FileMap), FileMap);
+  int frozen = 1, status;
+  ctx.str = p;
+  ctx.size = size;
+  status = load_chunk(L, reader_string, &ctx, chunkname, mode, &frozen);
+  if (status == LUA_OK && frozen == 2) {
+    /* Finalizers may still read lazy protos, see lj_load_freestate(). */
+    global_State *g = G(L);
+    fm->p = p;
+    fm->size = size;
+    fm->next = mref(g->filemaps, FileMap);
+    setmref(g->filemaps, fm);
+  } else {
+    lj_mem_freet(G(L), fm);
+    filemap_close(p, size);
+  }
+  return status;
+}
+#endif
+
+/* Like luaL_loadfilemap, but keeps the file mapped if an indexed bytecode
+** dump uses it in place. Processes which load the same file share its pages.
+*/
+LUALIB_API int luaL_loadfilefrozen(lua_State *L, const char *filename)
+{
+#if LJ_HASFILEMAP
+  const char *p;
+  size_t size;
+  if (filename && (p = filemap_open(filename, &size)) != NULL) {
+    const char *chunkname = lua_pushfstring(L, "@%s", filename);
+    int status = filemap_loadfrozen(L, p, size, chunkname, NULL);
+    lua_remove(L, -2);
+    return status;
+  }
+#endif
+  /* Fallback for stdin, pipes, empty files or no mmap support. */
+  return luaL_loadfilex(L, filename, NULL);
+}
+
+/* Unmap the files kept for frozen chunks, after all finalizers have run. */
+void lj_load_freestate(global_State *g)
+{
+#if LJ_HASFILEMAP
+  FileMap *fm = mref(g->filemaps, FileMap);
+  while (fm) {
+    FileMap *next = fm->next;
+    filemap_close(fm->p, fm->size);
+    lj_mem_freet(g, fm);
+    fm = next;
+  }
+  setmref(g->filemaps, NULL);
+#else
+  UNUSED(g);
+#endif
+}
+
+/* -- Cache of compiled chunks ------------------------------------------- */
+
+/*
+** With a cache directory set, source files loaded with luaL_loadfilex or
+** luaL_loadfilemapx are looked up by a hash of their contents, their chunk
+** name and the options that affect the parser. A hit loads a copy of the
+** indexed bytecode dump from the cache. A miss parses the source and
+** stores its dump under a temporary name, which is then renamed, so other
+** processes never see a partial file. Any failure to use the cache falls
+** back to parsing, so stale or foreign files are simply replaced.
+*/
+
+#define LOADCACHE_KEY	"_LOADCACHE"
+
+#if LJ_HASFILEMAP
+
+/* Stable hash for cache lookups. Unlike the string hash it isn't seeded. */
+static uint64_t cache_hash(uint64_t h, const char *p, size_t len)
+{
+  const char *pe = p + len;
+  h ^= (uint64_t)len;
+  for (; pe - p >= 8; p += 8) {
+    h ^= lj_getu32(p) | ((uint64_t)lj_getu32(p+4) << 32);
+    h *= U64x(9e3779b9,7f4a7c15);
+    h ^= h >> 29;
+  }
+  for (; p < pe; p++) {
+    h ^= (uint8_t)*p;
+    h *= U64x(9e3779b9,7f4a7c15);
+  }
+  return h ^ (h >> 32);
+}
+
+static int writer_file(lua_State *L, const void *p, size_t sz, void *ud)
+{
+  UNUSED(L);
+  return fwrite(p, 1, sz, (FILE *)ud) != sz;
+}
+
+/* Store the dump of the function on top of the stack in the cache. */
+static void cache_store(lua_State *L, const char *cachename)
+{
+#if LJ_TARGET_WINDOWS
+  int pid = (int)GetCurrentProcessId();
+#else
+  int pid = (int)getpid();
+#endif
+  const char *tmpname = lua_pushfstring(L, "%s.%d.%p", cachename, pid, L);
+  FILE *fp = fopen(tmpname, "wb");
+  if (fp) {
+    int err = lj_bcwrite(L, funcproto(funcV(L->top-2)), writer_file, fp,
+			 BCDUMP_F_INDEX);
+    if (fclose(fp)) err = 1;
+#if LJ_TARGET_WINDOWS
+    if (err || !MoveFileExA(tmpname, cachename, MOVEFILE_REPLACE_EXISTING))
+#else
+    if (err || rename(tmpname, cachename))
+#endif
+      remove(tmpname);
+  }
+  lua_pop(L, 1);
+}
+
+/* Load a source file through the cache. Returns -1 if it's not used. */
+static int cache_load(lua_State *L, const char *filename, const char *mode)
+{
+  const char *dir, *p, *q, *chunkname, *cachename;
+  size_t size, qsize;
+  char hex[17];
+  uint64_t h;
+  int i, status;
+  lua_getfield(L, LUA_REGISTRYINDEX, LOADCACHE_KEY);
+  dir = lua_tostring(L, -1);  /* Anchored by the registry. */
+  lua_pop(L, 1);
+  if (dir == NULL || (mode && (!strchr(mode, 't') || strchr(mode, 'd'))) ||
+      (p = filemap_open(filename, &size)) == NULL)
+    return -1;
+  if (*p == BCDUMP_HEAD1) {  /* Bytecode needs no cache. */
+    filemap_close(p, size);
+    return -1;
+  }
+  chunkname = lua_pushfstring(L, "@%s", filename);
+  h = BCDUMP_VERSION | ((LJ_BE*BCDUMP_F_BE + LJ_FR2*BCDUMP_F_FR2) << 8) |
+      (G(L)->ctormulti << 16);
+  h = cache_hash(h, chunkname, strlen(chunkname));
+  h = cache_hash(h, p, size);
+  for (i = 15; i >= 0; i--, h >>= 4)
+    hex[i] = "0123456789abcdef"[h & 15];
+  hex[16] = '\0';
+  cachename = lua_pushfstring(L, "%s" LUA_DIRSEP "%s.ljbc", dir, hex);
+  if ((q = filemap_open(cachename, &qsize)) != NULL) {
+    /* Read a copy, so reloading a file doesn't pin one mapping per load. */
+    StringReaderCtx ctx;
+    ctx.str = q;
+    ctx.size = qsize;
+    status = lua_loadx(L, reader_string, &ctx, cachename, "b");
+    filemap_close(q, qsize);
+    if (status == LUA_OK) {
+      filemap_close(p, size);
+      goto done;
+    }
+    lua_pop(L, 1);  /* Ignore a stale or broken file, it'll be replaced. */
+  }
+  {
+    StringReaderCtx ctx;
+    ctx.str = p;
+    ctx.size = size;
+    status = lua_loadx(L, reader_string, &ctx, chunkname, mode);
+    filemap_close(p, size);
+    if (status == LUA_OK)
+      cache_store(L, cachename);
+  }
+done:
+  lua_replace(L, -3);
+  lua_pop(L, 1);
+  return status;
+}
+
+#else
+
+static int cache_load(lua_State *L, const char *filename, const char *mode)
+{
+  UNUSED(L); UNUSED(filename); UNUSED(mode);
+  return -1;
+}
+
+#endif
+
+/* Set the directory for the cache of compiled chunks. NULL disables it. */
+LUALIB_API void luaL_setloadcache(lua_State *L, const char *dir)
+{
+  if (dir)
+    lua_pushstring(L, dir);
+  else
+    lua_pushnil(L);
+  lua_setfield(L, LUA_REGISTRYINDEX, LOADCACHE_KEY);
+}
+
+/* -- Load several files in parallel -------------------------------------- */
+
+/* Drop the table of results, keep the error message. */
+static int loadfiles_fail(lua_State *L, int status)
+{
+  lua_remove(L, -2);
+  return status;
+}
+
+#if LJ_HASLOADTHREADS
+
+/*
+** Each worker thread parses its share of the files on a private lua_State
+** and dumps the result as bytecode into a malloc'ed buffer. The calling
+** state then adopts the chunks with the bytecode reader, which interns all
+** strings and constants into its own global state.
+*/
+
+typedef struct LoadJob {
+  const char *filename;
+  const char *mode;
+  char *buf;		/* Bytecode dump or error message. */
+  size_t size, cap;
+  int status;
+} LoadJob;
+
+typedef struct LoadWorker {
+  LoadJob *job;		/* First job of this worker. */
+  int n, stride;	/* Jobs are job[0], job[stride], ... below job[n]. */
+  int started;
+  uint8_t ctormulti;	/* Parser modes of the calling state. */
+  const char *cachedir;	/* Cache directory of the calling state or NULL. */
+#if LJ_TARGET_WINDOWS
+  HANDLE thread;
+#else
+  pthread_t thread;
+#endif
+} LoadWorker;
+
+static int writer_job(lua_State *L, const void *p, size_t sz, void *ud)
+{
+  LoadJob *job = (LoadJob *)ud;
+  UNUSED(L);
+  if (sz > job->cap - job->size) {
+    size_t cap = job->cap ? job->cap : LUAL_BUFFERSIZE;
+    char *buf;
+    while (cap - job->size < sz) cap += cap;
+    buf = (char *)realloc(job->buf, cap);
+    if (buf == NULL) return 1;
+    job->buf = buf;
+    job->cap = cap;
+  }
+  memcpy(job->buf + job->size, p, sz);
+  job->size += sz;
+  return 0;
+}
+
+static void load_worker(LoadWorker *w)
+{
+  lua_State *L = luaL_newstate();
+  int i;
+  if (L) {  /* Parse and look up the cache like the calling state. */
+    G(L)->ctormulti = w->ctormulti;
+    if (w->cachedir) luaL_setloadcache(L, w->cachedir);
+  }
+  for (i = 0; i < w->n; i += w->stride) {
+    LoadJob *job = &w->job[i];
+    if (L == NULL) {
+      job->status = LUA_ERRMEM;
+      continue;
+    }
+    job->status = luaL_loadfilemapx(L, job->filename, job->mode);
+    if (job->status == LUA_OK) {
+      if (lua_dump(L, writer_job, job))
+	job->status = LUA_ERRMEM;
+    } else {
+      size_t len = 0;
+      const char *msg = lua_tolstring(L, -1, &len);
+      if (msg) writer_job(L, msg, len, job);
+    }
+    lua_settop(L, 0);
+  }
+  if (L) lua_close(L);
+}
+
+#if LJ_TARGET_WINDOWS
+static DWORD WINAPI load_thread(LPVOID ud)
+{
+  load_worker((LoadWorker *)ud);
+  return 0;
+}
+#else
+static void *load_thread(void *ud)
+{
+  load_worker((LoadWorker *)ud);
+  return NULL;
+}
+#endif
+
+static int load_ncpu(void)
+{
+#if LJ_TARGET_WINDOWS
+  SYSTEM_INFO si;
+  GetSystemInfo(&si);
+  return (int)si.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? (int)n : 1;
+#else
+  return 1;
+#endif
+}
+
+static int loadfiles_threads(lua_State *L, const char *const *filenames,
+			     int n, int nthreads, const char *mode)
+{
+  LoadJob *job = (LoadJob *)calloc((size_t)n, sizeof(LoadJob));
+  LoadWorker *w = (LoadWorker *)calloc((size_t)nthreads, sizeof(LoadWorker));
+  const char *cachedir;
+  int i, status = LUA_OK;
+  if (job == NULL || w == NULL) {
+    free(job);
+    free(w);
+    lua_pushliteral(L, "not enough memory");
+    return LUA_ERRMEM;
+  }
+  for (i = 0; i < n; i++) {
+    job[i].filename = filenames[i];
+    job[i].mode = mode;
+  }
+  lua_getfield(L, LUA_REGISTRYINDEX, LOADCACHE_KEY);
+  cachedir = lua_tostring(L, -1);  /* Anchored by the registry. */
+  lua_pop(L, 1);
+  for (i = 0; i < nthreads; i++) {
+    w[i].job = job + i;
+    w[i].n = n - i;
+    w[i].stride = nthreads;
+    w[i].ctormulti = G(L)->ctormulti;
+    w[i].cachedir = cachedir;
+#if LJ_TARGET_WINDOWS
+    w[i].thread = CreateThread(NULL, 0, load_thread, &w[i], 0, NULL);
+    w[i].started = w[i].thread != NULL;
+#else
+    w[i].started = pthread_create(&w[i].thread, NULL, load_thread, &w[i]) == 0;
+#endif
+    if (!w[i].started)  /* Out of threads: do this share on the caller. */
+      load_worker(&w[i]);
+  }
+  for (i = 0; i < nthreads; i++) {
+    if (w[i].started) {
+#if LJ_TARGET_WINDOWS
+      WaitForSingleObject(w[i].thread, INFINITE);
+      CloseHandle(w[i].thread);
+#else
+      pthread_join(w[i].thread, NULL);
+#endif
+    }
+  }
+  for (i = 0; i < n; i++) {
+    if (status == LUA_OK) {
+      if (job[i].status == LUA_OK) {
+	const char *chunkname = job[i].filename ?
+	  lua_pushfstring(L, "@%s", job[i].filename) : "=stdin";
+	status = luaL_loadbufferx(L, job[i].buf, job[i].size, chunkname, "b");
+	if (job[i].filename) lua_remove(L, -2);
+      } else {
+	status = job[i].status;
+	lua_pushlstring(L, job[i].buf ? job[i].buf : "", job[i].size);
+      }
+      if (status == LUA_OK)
+	lua_rawseti(L, -2, i+1);
+      else
+	loadfiles_fail(L, status);
+    }
+    free(job[i].buf);
+  }
+  free(job);
+  free(w);
+  return status;
+}
+
+#endif
+
+/*
+** Load n files and push a table with one function per file at 1..n. On
+** failure only the error message is pushed. nthreads <= 0 uses one thread
+** per CPU.
+*/
+LUALIB_API int luaL_loadfilesx(lua_State *L, const char *const *filenames,
+			       int n, int nthreads, const char *mode)
+{
+  int i;
+  lua_createtable(L, n, 0);
+#if LJ_HASLOADTHREADS
+  if (nthreads <= 0) nthreads = load_ncpu();
+  if (mode && strchr(mode, 'd')) nthreads = 1;  /* Data can't be dumped. */
+  if (nthreads > n) nthreads = n;
+  if (nthreads > 1)
+    return loadfiles_threads(L, filenames, n, nthreads, mode);
+#else
+  UNUSED(nthreads);
+#endif
+  for (i = 0; i < n; i++) {
+    int status = luaL_loadfilemapx(L, filenames[i], mode);
+    if (status != LUA_OK)
+      return loadfiles_fail(L, status);
+    lua_rawseti(L, -2, i+1);
+  }
+  return LUA_OK;
+}
+
+LUALIB_API int luaL_loadfiles(lua_State *L, const char *const *filenames,
+			      int n)
+{
+  return luaL_loadfilesx(L, filenames, n, 0, NULL);
+}
+
 /* -- Dump bytecode ------------------------------------------------------- */
 
 LUA_API int lua_dump(lua_State *L, lua_Writer writer, void *data)
@@ -166,7 +166,9 @@ TValue *lj_meta_tset(lua_State *L, cTValue *o, cTValue *k)
     cTValue *mo;
     if (LJ_LIKELY(tvistab(o))) {
       GCtab *t = tabV(o);
-      cTValue *tv = lj_tab_get(L, t, k);
+      cTValue *tv;
+      lj_tab_checkcow(L, t);
+      tv = lj_tab_get(L, t, k);
       if (LJ_LIKELY(!tvisnil(tv))) {
 	t->nomm = 0;  /* Invalidate negative metamethod cache. */
 	lj_gc_anybarriert(L, t);
@@ -298,7 +300,7 @@ TValue *lj_meta_cat(lua_State *L, TValue *top, int left)
 	} else if (tvisint(o)) {
 	  lj_strfmt_putint(sb, intV(o));
 	} else {
-	  lj_strfmt_putfnum(sb, STRFMT_G14, numV(o));
+	  lj_strfmt_putfnum(sb, STRFMT_TOSTR(G(L)), numV(o));
 	}
       }
       setstrV(L, top, lj_buf_str(L, sb));
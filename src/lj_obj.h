@@ -426,6 +426,8 @@ typedef struct GCproto {
 #define proto_lineinfo(pt)	(mref((pt)->lineinfo, const void))
 #define proto_uvinfo(pt)	(mref((pt)->uvinfo, const uint8_t))
 #define proto_varinfo(pt)	(mref((pt)->varinfo, const uint8_t))
+/* Stub for a prototype of an indexed bytecode dump, see lj_bcread.c. */
+#define proto_islazy(pt)	((pt)->sizebc == 0)
 
 /* -- Upvalue object ------------------------------------------------------ */
 
@@ -499,6 +501,9 @@ typedef struct GCtab {
   GCHeader;
   uint8_t nomm;		/* Negative cache for fast metamethods. */
   int8_t colo;		/* Array colocation. */
+#if LJ_HASTABORD
+  uint8_t ord;		/* Hash part keeps insertion order. */
+#endif
   MRef array;		/* Array part. */
   GCRef gclist;
   GCRef metatable;	/* Must be at same offset in GCudata. */
@@ -511,6 +516,19 @@ typedef struct GCtab {
 } GCtab;
 
 #define sizetabcolo(n)	((n)*sizeof(TValue) + sizeof(GCtab))
+/* Stub for a template table of an indexed bytecode dump, see lj_bcread.c. */
+#define tab_islazy(t) \
+  ((t)->asize == 0 && tvisudata(&noderef((t)->node)->key))
+/* Table sharing the storage of a backing table, see lj_tab_dupcow(). */
+#define LJ_TAB_COW	0x80	/* Flag in the marked field. */
+#define tab_iscow(t)	(LJ_HASTABCOW && ((t)->marked & LJ_TAB_COW))
+#define tab_cowref(t)	(mref((t)->freetop, GCtab))	/* Backing table. */
+/* Hash part followed by its insertion order, see lj_tab_order(). */
+#if LJ_HASTABORD
+#define tab_isord(t)	((t)->ord)
+#else
+#define tab_isord(t)	0
+#endif
 #define tabref(r)	((GCtab *)gcref((r)))
 #define noderef(r)	(mref((r), Node))
 #define nextnode(n)	(mref((n)->next, Node))
@@ -612,6 +630,13 @@ typedef struct GCState {
 #if LJ_64
   MRef lightudseg;	/* Upper bits of lightuserdata segments. */
 #endif
+  GCSize loadlimit;	/* Defer GC steps during loads up to this (0 = off). */
+  GCSize loadpeak;	/* Max. memory allocated at the end of a load. */
+  uint32_t nstep;	/* Number of incremental GC steps. */
+  uint32_t ncycle;	/* Number of GC cycles finished by GC steps. */
+  uint32_t loadnum;	/* Number of chunks loaded. */
+  uint32_t loadstep;	/* Number of GC steps during loads. */
+  uint32_t loadcycle;	/* Number of GC cycles finished during loads. */
 } GCState;
 
 /* String interning state. */
@@ -622,7 +647,7 @@ typedef struct StrInternState {
   StrID id;		/* Next string ID. */
   uint8_t idreseed;	/* String ID reseed counter. */
   uint8_t second;	/* String interning table uses secondary hashing. */
-  uint8_t unused1;
+  uint8_t numfmt;	/* Use shortest round-trip number to string format. */
   uint8_t unused2;
   LJ_ALIGN(8) uint64_t seed;	/* Random string seed. */
 } StrInternState;
@@ -637,6 +662,9 @@ typedef struct global_State {
   uint8_t hookmask;	/* Hook mask. */
   uint8_t dispatchmode;	/* Dispatch mode. */
   uint8_t vmevmask;	/* VM event mask. */
+  uint8_t tabcow;	/* Copy-on-write TDUP mode (TABCOW_*). */
+  uint8_t ctormulti;	/* Expand calls at any position in constructors. */
+  uint8_t tabshrink;	/* GC shrinks mostly empty hash parts. */
   StrInternState str;	/* String interning. */
   volatile int32_t vmstate;  /* VM state or current JIT code trace number. */
   GCRef mainthref;	/* Link to main thread. */
@@ -655,6 +683,7 @@ typedef struct global_State {
   GCRef cur_L;		/* Currently executing lua_State. */
   MRef jit_base;	/* Current JIT code L->base or NULL. */
   MRef ctype_state;	/* Pointer to C type state. */
+  MRef filemaps;	/* Files kept mapped for frozen chunks. */
   PRNGState prng;	/* Global PRNG state. */
   GCRef gcroot[GCROOT_MAX];  /* GC roots. */
 } global_State;
@@ -2229,6 +2229,7 @@ LJFOLD(FLOAD any IRFL_TAB_ARRAY)
 LJFOLD(FLOAD any IRFL_TAB_NODE)
 LJFOLD(FLOAD any IRFL_TAB_ASIZE)
 LJFOLD(FLOAD any IRFL_TAB_HMASK)
+LJFOLD(FLOAD any IRFL_TAB_MARKED)
 LJFOLDF(fload_tab_ah)
 {
   TRef tr = lj_opt_cse(J);
@@ -72,14 +72,19 @@ static AliasRet aa_table(jit_State *J, IRRef ta, IRRef tb)
   return aa_escape(J, taba, tabb);
 }
 
-/* Check whether there's no aliasing table.clear. */
+/* Check whether there's no aliasing table.clear, table.move or unsharing. */
 static int fwd_aa_tab_clear(jit_State *J, IRRef lim, IRRef ta)
 {
   IRRef ref = J->chain[IR_CALLS];
   while (ref > lim) {
     IRIns *calls = IR(ref);
-    if (calls->op2 == IRCALL_lj_tab_clear &&
-	(ta == calls->op1 || aa_table(J, ta, calls->op1) != ALIAS_NO))
+    IRRef tb = calls->op1;
+    if (calls->op2 == IRCALL_lj_tab_move)
+      tb = IR(tb)->op2;  /* Destination is the last argument. */
+    else if (!(calls->op2 == IRCALL_lj_tab_clear ||
+	       calls->op2 == IRCALL_lj_tab_unshare))
+      tb = 0;
+    if (tb && (ta == tb || aa_table(J, ta, tb) != ALIAS_NO))
       return 0;  /* Conflict. */
     ref = calls->prev;
   }
@@ -574,7 +579,7 @@ static AliasRet aa_fref(jit_State *J, IRIns *refa, IRIns *refb)
     return ALIAS_NO;  /* Different fields. */
   if (refa->op1 == refb->op1)
     return ALIAS_MUST;  /* Same field, same object. */
-  else if (refa->op2 >= IRFL_TAB_META && refa->op2 <= IRFL_TAB_NOMM)
+  else if (refa->op2 >= IRFL_TAB_META && refa->op2 <= IRFL_TAB_MARKED)
     return aa_table(J, refa->op1, refb->op1);  /* Disambiguate tables. */
   else
     return ALIAS_MAY;  /* Same field, possibly different object. */
@@ -241,9 +241,11 @@ GCstr *lj_parse_keepstr(LexState *ls, const char *str, size_t len)
   /* NOBARRIER: the key is new or kept alive. */
   lua_State *L = ls->L;
   GCstr *s = lj_str_new(L, str, len);
-  TValue *tv = lj_tab_setstr(L, ls->fs->kt, s);
-  if (tvisnil(tv)) setboolV(tv, 1);
-  lj_gc_check(L);
+  if (ls->fs) {
+    TValue *tv = lj_tab_setstr(L, ls->fs->kt, s);
+    if (tvisnil(tv)) setboolV(tv, 1);
+    lj_gc_check(L);
+  }  /* Else the data parser anchors it before the next GC check. */
   return s;
 }
 
@@ -254,7 +256,7 @@ void lj_parse_keepcdata(LexState *ls, TValue *tv, GCcdata *cd)
   /* NOBARRIER: the key is new or kept alive. */
   lua_State *L = ls->L;
   setcdataV(L, tv, cd);
-  setboolV(lj_tab_set(L, ls->fs->kt, tv), 1);
+  if (ls->fs) setboolV(lj_tab_set(L, ls->fs->kt, tv), 1);
 }
 #endif
 
@@ -286,12 +288,17 @@ static int jmp_patchtestreg(FuncState *fs, BCPos pc, BCReg reg)
 {
   BCInsLine *ilp = &fs->bcbase[pc >= 1 ? pc-1 : pc];
   BCOp op = bc_op(ilp->ins);
-  if ((op >= BC_TDUPHI) && (op <= BC_KNUMHI)) {
-    if (!jmp_patchtestreg(fs, pc-1, reg)) {
-      return 0;
+  if (op == BC_NOP && pc >= 2 && bc_iswide(bc_op(ilp[-1].ins)) &&
+      bc_a(ilp->ins) == NO_REG) {  /* Wide constant with its operand word. */
+    if (reg == NO_REG) {
+      ilp[-1].ins = BCINS_AJ(BC_JMP, bc_a(fs->bcbase[pc].ins), 1);
+    } else {
+      setbc_a(&ilp[-1].ins, reg);
+      setbc_a(&ilp->ins, reg);
+      if (reg >= bc_a(ilp[1].ins))
+	setbc_a(&ilp[1].ins, reg+1);
     }
-  }
-  if (op == BC_ISTC || op == BC_ISFC) {
+  } else if (op == BC_ISTC || op == BC_ISFC) {
     if (reg != NO_REG && reg != bc_d(ilp->ins)) {
       setbc_a(&ilp->ins, reg);
     } else {  /* Nothing to store or already in the right register. */
@@ -442,6 +449,25 @@ static BCPos bcemit_INS(FuncState *fs, BCIns ins)
 
 #define bcptr(fs, e)			(&(fs)->bcbase[(e)->u.s.info].ins)
 
+/* Emit wide constant op. The hi-word of the index goes into the op and the
+** lo-word into the NOP operand word following it.
+*/
+static BCPos bcemit_wide(FuncState *fs, BCOp op, BCReg a, BCReg idx)
+{
+  BCPos pc = bcemit_AD(fs, op, a, idx >> 16);
+  bcemit_AD(fs, BC_NOP, a, idx & 0xffff);
+  return pc;
+}
+
+/* Patch destination of relocable expression, incl. the NOP operand word. */
+static void bcpatch_dst(FuncState *fs, ExpDesc *e, BCReg reg)
+{
+  BCInsLine *ilp = &fs->bcbase[e->u.s.info];
+  setbc_a(&ilp->ins, reg);
+  if (bc_iswide(bc_op(ilp->ins)))
+    setbc_a(&ilp[1].ins, reg);
+}
+
 /* -- Bytecode emitter for expressions ------------------------------------ */
 
 /* Discharge non-constant expression to any register. */
@@ -452,17 +478,12 @@ static void expr_discharge(FuncState *fs, ExpDesc *e)
     ins = BCINS_AD(BC_UGET, 0, e->u.s.info);
   } else if (e->k == VGLOBAL) {
     BCReg idx = const_str(fs, e);
-    if (idx <= BCMAX_D) {
-      ins = BCINS_AD(BC_GGET, 0, idx);
-    } else {
-      fs->flags |= PROTO_NOJIT;
-      BCReg reg = fs->freereg;
-      bcreg_reserve(fs, 1);
-      bcemit_AD(fs, BC_KINTLO, reg, idx&0xffff);
-      bcemit_AD(fs, BC_KSTRHI, reg, idx>>16);
-      ins = BCINS_AD(BC_GGETV, 0, reg);
-      bcreg_free(fs, reg);
+    if (idx > BCMAX_D) {
+      e->u.s.info = bcemit_wide(fs, BC_GGETX, 0, idx);
+      e->k = VRELOCABLE;
+      return;
     }
+    ins = BCINS_AD(BC_GGET, 0, idx);
   } else if (e->k == VINDEXED) {
     BCReg rc = e->u.s.aux;
     if ((int32_t)rc < 0) {
@@ -530,15 +551,12 @@ static void expr_toreg_nobranch(FuncState *fs, ExpDesc *e, BCReg reg)
   BCIns ins;
   expr_discharge(fs, e);
   if (e->k == VKSTR) {
-    BCReg k = const_str(fs, e);
-    if (k <= BCMAX_D) {
-      ins = BCINS_AD(BC_KSTR, reg, k);
-    }
-    else {
-      fs->flags |= PROTO_NOJIT;
-      bcemit_AD(fs, BC_KINTLO, reg, k & 0xffff);
-      ins = BCINS_AD(BC_KSTRHI, reg, k >> 16);
+    BCReg idx = const_str(fs, e);
+    if (idx > BCMAX_D) {
+      bcemit_wide(fs, BC_KSTRX, reg, idx);
+      goto noins;
     }
+    ins = BCINS_AD(BC_KSTR, reg, idx);
   } else if (e->k == VKNUM) {
 #if LJ_DUALNUM
     cTValue *tv = expr_numtv(e);
@@ -554,29 +572,24 @@ static void expr_toreg_nobranch(FuncState *fs, ExpDesc *e, BCReg reg)
 #endif
     {
       BCReg idx = const_num(fs, e);
-      if (idx <= BCMAX_D) {
-        ins = BCINS_AD(BC_KNUM, reg, const_num(fs, e));
-      }
-      else {
-        fs->flags |= PROTO_NOJIT;
-        bcemit_AD(fs, BC_KINTLO, reg, idx & 0xffff);
-        ins = BCINS_AD(BC_KNUMHI, reg, idx >> 16);
+      if (idx > BCMAX_D) {
+	bcemit_wide(fs, BC_KNUMX, reg, idx);
+	goto noins;
       }
+      ins = BCINS_AD(BC_KNUM, reg, idx);
     }
 #if LJ_HASFFI
   } else if (e->k == VKCDATA) {
     fs->flags |= PROTO_FFI;
     BCReg idx = const_gc(fs, obj2gco(cdataV(&e->u.nval)), LJ_TCDATA);
-    if (idx <= BCMAX_D) {
-      ins = BCINS_AD(BC_KCDATA, reg, idx);
-    } else {
-      fs->flags |= PROTO_NOJIT;
-      bcemit_AD(fs, BC_KINTLO, reg, idx & 0xffff);
-      ins = BCINS_AD(BC_KCDTHI, reg, idx >> 16);
+    if (idx > BCMAX_D) {
+      bcemit_wide(fs, BC_KCDTX, reg, idx);
+      goto noins;
     }
+    ins = BCINS_AD(BC_KCDATA, reg, idx);
 #endif
   } else if (e->k == VRELOCABLE) {
-    setbc_a(bcptr(fs, e), reg);
+    bcpatch_dst(fs, e, reg);
     goto noins;
   } else if (e->k == VNONRELOC) {
     if (reg == e->u.s.info)
@@ -674,46 +687,27 @@ static void bcemit_store(FuncState *fs, ExpDesc *var, ExpDesc *e)
       ins = BCINS_AD(BC_USETP, var->u.s.info, const_pri(e));
     else if (e->k == VKSTR) {
       BCReg idx = const_str(fs, e);
-      if (idx <= BCMAX_D) {
-        ins = BCINS_AD(BC_USETS, var->u.s.info, idx);
-      } else {
-        fs->flags |= PROTO_NOJIT;
-        BCReg reg = fs->freereg;
-        bcreg_reserve(fs, 1);
-        bcemit_AD(fs, BC_KINTLO, reg, idx & 0xffff);
-        bcemit_AD(fs, BC_KSTRHI, reg, idx >> 16);
-        ins = BCINS_AD(BC_USETV, var->u.s.info, reg);
-        bcreg_free(fs, reg);
-      }
+      if (idx <= BCMAX_D)
+	ins = BCINS_AD(BC_USETS, var->u.s.info, idx);
+      else
+	ins = BCINS_AD(BC_USETV, var->u.s.info, expr_toanyreg(fs, e));
     } else if (e->k == VKNUM) {
       BCReg idx = const_num(fs, e);
-      if (idx <= BCMAX_D) {
-        ins = BCINS_AD(BC_USETN, var->u.s.info, idx);
-      } else {
-        fs->flags |= PROTO_NOJIT;
-        BCReg reg = fs->freereg;
-        bcreg_reserve(fs, 1);
-        bcemit_AD(fs, BC_KINTLO, reg, idx & 0xffff);
-        bcemit_AD(fs, BC_KNUMHI, reg, idx >> 16);
-        ins = BCINS_AD(BC_USETV, var->u.s.info, reg);
-        bcreg_free(fs, reg);
-      }
+      if (idx <= BCMAX_D)
+	ins = BCINS_AD(BC_USETN, var->u.s.info, idx);
+      else
+	ins = BCINS_AD(BC_USETV, var->u.s.info, expr_toanyreg(fs, e));
     } else
       ins = BCINS_AD(BC_USETV, var->u.s.info, expr_toanyreg(fs, e));
   } else if (var->k == VGLOBAL) {
     BCReg ra = expr_toanyreg(fs, e);
     BCReg idx = const_str(fs, var);
-    if (idx <= BCMAX_D) {
-      ins = BCINS_AD(BC_GSET, ra, const_str(fs, var));
-    } else {
-      fs->flags |= PROTO_NOJIT;
-      BCReg reg = fs->freereg;
-      bcreg_reserve(fs, 1);
-      bcemit_AD(fs, BC_KINTLO, reg, idx & 0xffff);
-      bcemit_AD(fs, BC_KSTRHI, reg, idx >> 16);
-      ins = BCINS_AD(BC_GSETV, 0, reg);
-      bcreg_free(fs, reg);
+    if (idx > BCMAX_D) {
+      bcemit_wide(fs, BC_GSETX, ra, idx);
+      expr_free(fs, e);
+      return;
     }
+    ins = BCINS_AD(BC_GSET, ra, idx);
   } else {
     BCReg ra, rc;
     lj_assertFS(var->k == VINDEXED, "bad expr type %d", var->k);
@@ -751,13 +745,10 @@ static void bcemit_method(FuncState *fs, ExpDesc *e, ExpDesc *key)
     bcemit_ABC(fs, BC_TGETS, func, obj, idx);
   } else {
     bcreg_reserve(fs, 3+LJ_FR2);
-    if (idx <= BCMAX_D) {
-        bcemit_AD(fs, BC_KSTR, func + 2 + LJ_FR2, idx);
-    } else {
-      fs->flags |= PROTO_NOJIT;
-      bcemit_AD(fs, BC_KINTLO, func + 2 + LJ_FR2, idx & 0xffff);
-      bcemit_AD(fs, BC_KSTRHI, func + 2 + LJ_FR2, idx >> 16);
-    }
+    if (idx <= BCMAX_D)
+      bcemit_AD(fs, BC_KSTR, func+2+LJ_FR2, idx);
+    else
+      bcemit_wide(fs, BC_KSTRX, func+2+LJ_FR2, idx);
     bcemit_ABC(fs, BC_TGETV, func, obj, func+2+LJ_FR2);
     fs->freereg--;
   }
@@ -927,29 +918,25 @@ static void bcemit_comp(FuncState *fs, BinOpr opr, ExpDesc *e1, ExpDesc *e2)
     case VKSTR:
       idx = const_str(fs, e2);
       if (idx <= BCMAX_D) {
-        ins = BCINS_AD(op+(BC_ISEQS-BC_ISEQV), ra, idx);
+	ins = BCINS_AD(op+(BC_ISEQS-BC_ISEQV), ra, idx);
       } else {
-        fs->flags |= PROTO_NOJIT;
-        reg = fs->freereg;
-        bcreg_reserve(fs, 1);
-        bcemit_AD(fs, BC_KINTLO, reg, idx & 0xffff);
-        bcemit_AD(fs, BC_KSTRHI, reg, idx >> 16);
-        ins = BCINS_AD(op, ra, reg);
-        bcreg_free(fs, reg);
+	reg = fs->freereg;
+	bcreg_reserve(fs, 1);
+	bcemit_wide(fs, BC_KSTRX, reg, idx);
+	ins = BCINS_AD(op, ra, reg);
+	bcreg_free(fs, reg);
       }
       break;
     case VKNUM:
       idx = const_num(fs, e2);
       if (idx <= BCMAX_D) {
-        ins = BCINS_AD(op + (BC_ISEQN - BC_ISEQV), ra, idx);
+	ins = BCINS_AD(op+(BC_ISEQN-BC_ISEQV), ra, idx);
       } else {
-        fs->flags |= PROTO_NOJIT;
-        reg = fs->freereg;
-        bcreg_reserve(fs, 1);
-        bcemit_AD(fs, BC_KINTLO, reg, idx & 0xffff);
-        bcemit_AD(fs, BC_KNUMHI, reg, idx >> 16);
-        ins = BCINS_AD(op, ra, reg);
-        bcreg_free(fs, reg);
+	reg = fs->freereg;
+	bcreg_reserve(fs, 1);
+	bcemit_wide(fs, BC_KNUMX, reg, idx);
+	ins = BCINS_AD(op, ra, reg);
+	bcreg_free(fs, reg);
       }
       break;
     default:
@@ -1053,7 +1040,7 @@ static void bcemit_unop(FuncState *fs, BCOp op, ExpDesc *e)
       return;
     } else if (e->k == VRELOCABLE) {
       bcreg_reserve(fs, 1);
-      setbc_a(bcptr(fs, e), fs->freereg-1);
+      bcpatch_dst(fs, e, fs->freereg-1);
       e->u.s.info = fs->freereg-1;
       e->k = VNONRELOC;
     } else {
@@ -1451,6 +1438,37 @@ static void fs_fixup_uv2(FuncState *fs, GCproto *pt)
   }
 }
 
+/* Return an identical template table seen earlier in the chunk, if any. */
+static GCtab *fs_share_ktab(FuncState *fs, GCtab *t)
+{
+  lua_State *L = fs->L;
+  MSize i, na = t->asize, nn = t->hmask ? t->hmask+1 : 0;
+  MSize sz = (1 + na + 2*nn) * (MSize)sizeof(TValue);
+  Node *node = noderef(t->node);
+  TValue *p, *tv;
+  if (gcref(t->metatable) || na + nn > 256)  /* Only dedup small templates. */
+    return t;
+  /* The sizes and the raw key and value bits are the content key. GC refs
+  ** are unique.
+  */
+  p = (TValue *)lj_buf_tmp(L, sz);
+  p->u32.lo = na;
+  p->u32.hi = nn;
+  p++;
+  if (na) memcpy(p, tvref(t->array), na*sizeof(TValue));
+  for (i = 0; i < nn; i++) {
+    p[na+2*i] = node[i].key;
+    p[na+2*i+1] = node[i].val;
+  }
+  tv = lj_tab_setstr(L, fs->ls->ktab, lj_str_new(L, (const char *)(p-1), sz));
+  if (tvisnil(tv)) {
+    settabV(L, tv, t);
+    lj_gc_anybarriert(L, fs->ls->ktab);
+    return t;
+  }
+  return tabV(tv);
+}
+
 /* Fixup constants for prototype. */
 static void fs_fixup_k(FuncState *fs, GCproto *pt, void *kptr)
 {
@@ -1495,6 +1513,8 @@ static void fs_fixup_k(FuncState *fs, GCproto *pt, void *kptr)
 	}
       } else {
 	GCobj *o = gcV(&n->key);
+	if (tvistab(&n->key))  /* Share template tables across the chunk. */
+	  o = obj2gco(fs_share_ktab(fs, gco2tab(o)));
 	setgcref(((GCRef *)kptr)[~kidx], o);
 	lj_gc_objbarrier(fs->L, pt, o);
 	if (tvisproto(&n->key))
@@ -1655,7 +1675,7 @@ static void fs_fixup_ret(FuncState *fs)
 	/* Replace with UCLO plus branch. */
 	fs->bcbase[pc].ins = BCINS_AD(BC_UCLO, 0, offset);
 	break;
-      case BC_FNEW:
+      case BC_FNEW: case BC_FNEWX:
 	return;  /* We're done. */
       default:
 	break;
@@ -1816,17 +1836,27 @@ static void expr_kvalue(FuncState *fs, TValue *v, ExpDesc *e)
   }
 }
 
+/* Check whether the current table constructor item is the last one. */
+static int expr_table_islast(LexState *ls)
+{
+  return ls->tok == '}' ||
+	 ((ls->tok == ',' || ls->tok == ';') && lj_lex_lookahead(ls) == '}');
+}
+
 /* Parse table constructor expression. */
 static void expr_table(LexState *ls, ExpDesc *e)
 {
   FuncState *fs = ls->fs;
   BCLine line = ls->linenumber;
   GCtab *t = NULL;
-  int vcall = 0, needarr = 0, fixt = 0;
+  int vcall = 0, needarr = 0, fixt = 0, grown = 0, sparse = 0;
+  int multi = G(ls->L)->ctormulti;  /* Expand calls at any position? */
+  int dyn = 0;  /* Running index in idxreg is only known at runtime. */
   uint32_t narr = 1;  /* First array index. */
   uint32_t nhash = 0;  /* Number of hash entries. */
+  uint32_t nidx = 0;  /* Array index currently held in idxreg. */
   BCReg freg = fs->freereg;
-  BCReg tabreg = freg;
+  BCReg tabreg = freg, idxreg = 0;
   BCPos pc = bcemit_AD(fs, BC_TNEW, tabreg, 0);
   expr_init(e, VNONRELOC, tabreg);
   bcreg_reserve(fs, 1);
@@ -1834,11 +1864,13 @@ static void expr_table(LexState *ls, ExpDesc *e)
   lex_check(ls, '{');
   while (ls->tok != '}') {
     ExpDesc key, val;
+    int pos = 0, mret;
     vcall = 0;
     if (ls->tok == '[') {
       expr_bracket(ls, &key);  /* Already calls expr_toval. */
       if (!expr_isk(&key)) expr_index(fs, e, &key);
       if (expr_isnumk(&key) && expr_numiszero(&key)) needarr = 1; else nhash++;
+      if (expr_isnumk(&key)) sparse = 1;
       lex_check(ls, '=');
     } else if ((ls->tok == TK_name || (!LJ_52 && ls->tok == TK_goto)) &&
 	       lj_lex_lookahead(ls) == '=') {
@@ -1849,10 +1881,15 @@ static void expr_table(LexState *ls, ExpDesc *e)
       expr_init(&key, VKNUM, 0);
       setintV(&key.u.nval, (int)narr);
       narr++;
-      needarr = vcall = 1;
+      needarr = vcall = pos = 1;
+      if ((narr > 256 || multi) && !idxreg) {  /* Reserve index register. */
+	idxreg = freg++;
+	bcreg_reserve(fs, 1);
+      }
     }
     expr(ls, &val);
-    if (expr_isk(&key) && key.k != VKNIL &&
+    if (pos && val.k == VKNIL) sparse = 1;
+    if (expr_isk(&key) && key.k != VKNIL && !(pos && dyn) &&
 	(/*key.k == VKSTR || */expr_isk_nojump(&val))) {
       /* NOTE: commented code above is because when constructed table only has 
          string keys with non-constant values, we end up TDUPing an empty table */
@@ -1861,22 +1898,29 @@ static void expr_table(LexState *ls, ExpDesc *e)
 	      BCReg kidx;
 	      t = lj_tab_new(fs->L, needarr ? narr : 0, hsize2hbits(nhash));
 	      kidx = const_gc(fs, obj2gco(t), LJ_TTAB);
-        if (fs->nkgc < BCMAX_D) {
-          fs->bcbase[pc].ins = BCINS_AD(BC_TDUP, tabreg, kidx);
-        } else {
-          fs->bcbase[pc].ins = BCINS_AD(BC_KINTLO, tabreg, kidx & 0xffff);
-          bcemit_INS(fs, 0);
-          for (BCPos p = fs->pc - 1; p > pc + 1; --p) {
-            fs->bcbase[p] = fs->bcbase[p - 1];
-          }
-          fs->bcbase[pc + 1] = fs->bcbase[pc];
-          fs->bcbase[pc + 1].ins = BCINS_AD(BC_TDUPHI, tabreg, kidx >> 16);
-          fs->flags |= PROTO_NOJIT;
-        }
+	      if (kidx <= BCMAX_D) {
+	        fs->bcbase[pc].ins = BCINS_AD(BC_TDUP, tabreg, kidx);
+	      } else {  /* Make room for the NOP operand word after TNEW. */
+	        BCPos p;
+	        bcemit_INS(fs, 0);
+	        for (p = fs->pc - 1; p > pc + 1; --p)
+	          fs->bcbase[p] = fs->bcbase[p - 1];
+	        fs->bcbase[pc+1].line = fs->bcbase[pc].line;
+	        fs->bcbase[pc].ins = BCINS_AD(BC_TDUPX, tabreg, kidx >> 16);
+	        fs->bcbase[pc+1].ins = BCINS_AD(BC_NOP, tabreg, kidx & 0xffff);
+	      }
       }
       vcall = 0;
-      expr_kvalue(fs, &k, &key);
-      v = lj_tab_set(fs->L, t, &k);
+      if (pos) {  /* Append positional constant directly to the array part. */
+	if (narr > t->asize) {  /* Grow geometrically, trimmed below. */
+	  lj_tab_reasize(fs->L, t, 2*(narr-1));
+	  grown = 1;
+	}
+	v = arrayslot(t, narr-1);
+      } else {
+	expr_kvalue(fs, &k, &key);
+	v = lj_tab_set(fs->L, t, &k);
+      }
       lj_gc_anybarriert(fs->L, t);
       if (expr_isk_nojump(&val)) {  /* Add const key/value to template table. */
 	    expr_kvalue(fs, v, &val);
@@ -1887,9 +1931,31 @@ static void expr_table(LexState *ls, ExpDesc *e)
       }
     } else {
     nonconst:
+      mret = pos && val.k == VCALL && multi && (dyn || !expr_table_islast(ls));
       if (val.k != VCALL) { expr_toanyreg(fs, &val); vcall = 0; }
-      if (expr_isk(&key)) expr_index(fs, e, &key);
-      bcemit_store(fs, e, &val);
+      if (mret || (pos && idxreg && (dyn || narr > 256))) {
+	/* Insert at running index, no key constant. */
+	if (!mret) expr_toanyreg(fs, &val);
+	if (!dyn && nidx != narr-1) {
+	  ExpDesc en;
+	  expr_init(&en, VKNUM, 0);
+	  setintV(&en.u.nval, (int)(narr-1));
+	  expr_toreg_nobranch(fs, &en, idxreg);
+	}
+	if (mret) {  /* Insert all results and continue after them. */
+	  BCIns *ip = bcptr(fs, &val);
+	  setbc_b(ip, 0);  /* Allow mulret in CALL. */
+	  bcemit_ABC(fs, BC_TSETMR, bc_a(*ip), tabreg, idxreg);
+	  dyn = 1;
+	  vcall = 0;
+	} else {
+	  bcemit_ABC(fs, BC_TINS, val.u.s.info, tabreg, idxreg);
+	}
+	nidx = narr;
+      } else {
+	if (expr_isk(&key)) expr_index(fs, e, &key);
+	bcemit_store(fs, e, &val);
+      }
     }
     fs->freereg = freg;
     if (!lex_opt(ls, ',') && !lex_opt(ls, ';')) break;
@@ -1897,24 +1963,36 @@ static void expr_table(LexState *ls, ExpDesc *e)
   lex_match(ls, '}', '{', line);
   if (vcall) {
     BCInsLine *ilp = &fs->bcbase[fs->pc-1];
+    ExpDesc en;
+    BCReg idx;
     lj_assertFS(bc_a(ilp->ins) == freg &&
-      bc_op(ilp->ins) == (narr > 256 ? BC_TSETV : BC_TSETB),
+      (bc_op(ilp->ins) == BC_TINS || bc_op(ilp->ins) == BC_TSETB),
       "bad CALL code generation");
-    ExpDesc en;
     expr_init(&en, VKNUM, 0);
     en.u.nval.u32.lo = narr - 1;
     en.u.nval.u32.hi = 0x43300000;  /* Biased integer to avoid denormals. */
-    BCReg idx = const_num(fs, &en);
-    if (narr > 256) { fs->pc--; ilp--; } // remove KNUM before TSETV
-    setbc_b(&ilp[-1].ins, 0); // allow mulret in CALL
+    idx = const_num(fs, &en);
+    if (bc_op(ilp->ins) == BC_TINS) {  /* Drop TINS and index load. */
+      fs->pc--;
+      while (bc_a(fs->bcbase[fs->pc-1].ins) == idxreg) fs->pc--;
+      setbc_b(&fs->bcbase[fs->pc-1].ins, 0);  /* Allow mulret in CALL. */
+    } else {
+      setbc_b(&ilp[-1].ins, 0); // allow mulret in CALL
+      if (idxreg) fs->pc--;  /* Drop TSETB. */
+    }
+    if (idxreg) {  /* TSETM needs table at A-1. */
+      bcemit_AD(fs, BC_MOV, idxreg, tabreg);
+      bcemit_INS(fs, 0);
+      ilp = &fs->bcbase[fs->pc-1];
+    }
     if (idx <= BCMAX_D) {
       ilp->ins = BCINS_AD(BC_TSETM, freg, idx);
     } else {
-      fs->flags |= PROTO_NOJIT;
       ilp->ins = BCINS_AD(BC_TSTML, freg, idx >> 16);
-      bcemit_AD(fs, BC_NOP, 0, idx & 0xffff);
+      bcemit_AD(fs, BC_NOP, freg, idx & 0xffff);
     }
   }
+  if (idxreg) fs->freereg = tabreg+1;  /* Release index register. */
   if (pc == fs->pc-1) {  /* Make expr relocable if possible. */
     e->u.s.info = pc;
     fs->freereg--;
@@ -1931,6 +2009,15 @@ static void expr_table(LexState *ls, ExpDesc *e)
   } else {
     if (needarr && t->asize < narr)
       lj_tab_reasize(fs->L, t, narr-1);
+    if (grown) {  /* Trim the slack left by geometric growth. */
+      if (sparse) {  /* Size holes and integer keys like lj_tab_set() did. */
+	lj_tab_rehash(fs->L, t);
+	if (t->asize < narr)
+	  lj_tab_reasize(fs->L, t, narr-1);
+      } else if (t->asize > narr) {
+	lj_tab_reasize(fs->L, t, narr-1);
+      }
+    }
     if (fixt) {  /* Fix value for dummy keys in template table. */
       Node *node = noderef(t->node);
       uint32_t i, hmask = t->hmask;
@@ -1983,6 +2070,7 @@ static void parse_body(LexState *ls, ExpDesc *e, int needself, BCLine line)
   FuncState fs, *pfs = ls->fs;
   FuncScope bl;
   GCproto *pt;
+  BCReg kidx;
   ptrdiff_t oldbase = pfs->bcbase - ls->bcstack;
   fs_init(ls, &fs);
   fscope_begin(&fs, &bl, 0);
@@ -1997,8 +2085,9 @@ static void parse_body(LexState *ls, ExpDesc *e, int needself, BCLine line)
   pfs->bcbase = ls->bcstack + oldbase;  /* May have been reallocated. */
   pfs->bclim = (BCPos)(ls->sizebcstack - oldbase);
   /* Store new prototype in the constant array of the parent. */
-  expr_init(e, VRELOCABLE,
-	    bcemit_AD(pfs, BC_FNEW, 0, const_gc(pfs, obj2gco(pt), LJ_TPROTO)));
+  kidx = const_gc(pfs, obj2gco(pt), LJ_TPROTO);
+  expr_init(e, VRELOCABLE, kidx <= BCMAX_D ? bcemit_AD(pfs, BC_FNEW, 0, kidx) :
+				     bcemit_wide(pfs, BC_FNEWX, 0, kidx));
 #if LJ_HASFFI
   pfs->flags |= (fs.flags & PROTO_FFI);
 #endif
@@ -2833,6 +2922,147 @@ static void parse_chunk(LexState *ls)
   synlevel_end(ls);
 }
 
+/* -- Data parser --------------------------------------------------------- */
+
+/*
+** A data chunk is 'return <value>', where the value is built only from
+** nil, booleans, numbers, strings and table constructors with such keys
+** and values. The value is built directly on the Lua stack, without any
+** bytecode or constant table. Lexed strings aren't anchored (ls->fs is
+** NULL), so GC checks are only done when everything live is on the stack.
+*/
+
+static void data_value(LexState *ls);
+
+/* Parse a data table constructor and push the table. */
+static void data_table(LexState *ls)
+{
+  lua_State *L = ls->L;
+  BCLine line = ls->linenumber;
+  GCtab *t = lj_tab_new(L, 0, 0);
+  uint32_t narr = 1;  /* Next positional index. */
+  int grown = 0, sparse = 0;
+  settabV(L, L->top, t);
+  incr_top(L);
+  synlevel_begin(ls);
+  lex_check(ls, '{');
+  while (ls->tok != '}') {
+    TValue *v;
+    int pos = 0;
+    if (ls->tok == '[') {
+      lj_lex_next(ls);
+      data_value(ls);
+      lex_check(ls, ']');
+      if (tvisnil(L->top-1))
+	lj_lex_error(ls, 0, LJ_ERR_NILIDX);
+      if (tvisnumber(L->top-1)) sparse = 1;
+      lex_check(ls, '=');
+    } else if ((ls->tok == TK_name || (!LJ_52 && ls->tok == TK_goto)) &&
+	       lj_lex_lookahead(ls) == '=') {
+      setstrV(L, L->top, lex_str(ls));
+      incr_top(L);
+      lex_check(ls, '=');
+    } else {
+      setintV(L->top, (int32_t)narr);
+      incr_top(L);
+      narr++;
+      pos = 1;
+    }
+    data_value(ls);
+    if (pos && tvisnil(L->top-1)) sparse = 1;
+    if (pos) {  /* Append to array part, grow geometrically. */
+      if (narr > t->asize) {
+	lj_tab_reasize(L, t, 2*(narr-1));
+	grown = 1;
+      }
+      v = arrayslot(t, narr-1);
+    } else if (tvisnil(L->top-1)) {  /* Assigning nil only clears a key. */
+      v = (TValue *)lj_tab_get(L, t, L->top-2);
+      if (tvisnil(v)) v = NULL;
+    } else {
+      v = lj_tab_set(L, t, L->top-2);
+    }
+    if (v) {
+      copyTV(L, v, L->top-1);
+      lj_gc_anybarriert(L, t);
+    }
+    L->top -= 2;
+    if (ls->tok == ',' || ls->tok == ';')
+      lj_gc_check(L);  /* Separator holds no string, all else is anchored. */
+    if (!lex_opt(ls, ',') && !lex_opt(ls, ';')) break;
+  }
+  lex_match(ls, '}', '{', line);
+  if (grown) {  /* Trim the slack like expr_table() does. */
+    if (sparse) {
+      lj_tab_rehash(L, t);
+      if (t->asize < narr)
+	lj_tab_reasize(L, t, narr-1);
+    } else if (t->asize > narr) {
+      lj_tab_reasize(L, t, narr-1);
+    }
+  }
+  synlevel_end(ls);
+}
+
+/* Parse a data value and push it. */
+static void data_value(LexState *ls)
+{
+  lua_State *L = ls->L;
+  TValue *o = L->top;
+  switch (ls->tok) {
+  case '{':
+    data_table(ls);
+    return;
+  case TK_nil:
+    setnilV(o);
+    break;
+  case TK_true:
+    setboolV(o, 1);
+    break;
+  case TK_false:
+    setboolV(o, 0);
+    break;
+  case TK_number: case TK_string:
+    copyTV(L, o, &ls->tokval);
+    break;
+  case '-':  /* Only a negative number literal is allowed. */
+    lj_lex_next(ls);
+    if (ls->tok != TK_number || tviscdata(&ls->tokval))
+      err_syntax(ls, LJ_ERR_XDATA);
+    if (tvisint(&ls->tokval) && intV(&ls->tokval) != (int32_t)0x80000000)
+      setintV(o, -intV(&ls->tokval));  /* Same as BC_UNM for integers. */
+    else
+      setnumV(o, -numberVnum(&ls->tokval));
+    break;
+  default:
+    if (ls->tok == TK_name) {  /* Lookahead may have clobbered the name. */
+      lj_buf_reset(&ls->sb);
+      lj_buf_putstr(&ls->sb, strV(&ls->tokval));
+    }
+    err_syntax(ls, LJ_ERR_XDATA);
+  }
+  incr_top(L);
+  lj_lex_next(ls);
+}
+
+/* Entry point of data parser. Pushes the returned value. */
+void lj_parse_data(LexState *ls)
+{
+  lua_State *L = ls->L;
+  ls->chunkname = lj_str_newz(L, ls->chunkarg);
+  setstrV(L, L->top, ls->chunkname);  /* Anchor chunkname string. */
+  incr_top(L);
+  ls->level = 0;
+  lj_lex_next(ls);  /* Read-ahead first token. */
+  lex_check(ls, TK_return);
+  data_value(ls);
+  lex_opt(ls, ';');
+  if (ls->tok != TK_eof)
+    err_token(ls, TK_eof);
+  L->top--;
+  copyTV(L, L->top-1, L->top);  /* Replace chunkname with value. */
+}
+
 /* Entry point of bytecode parser. */
 GCproto *lj_parse(LexState *ls)
 {
@@ -2847,6 +3077,9 @@ GCproto *lj_parse(LexState *ls)
 #endif
   setstrV(L, L->top, ls->chunkname);  /* Anchor chunkname string. */
   incr_top(L);
+  ls->ktab = lj_tab_new(L, 0, 0);
+  settabV(L, L->top, ls->ktab);  /* Anchor template table cache. */
+  incr_top(L);
   ls->level = 0;
   fs_init(ls, &fs);
   fs.linedefined = 0;
@@ -2861,7 +3094,7 @@ GCproto *lj_parse(LexState *ls)
   if (ls->tok != TK_eof)
     err_token(ls, TK_eof);
   pt = fs_finish(ls, ls->linenumber);
-  L->top--;  /* Drop chunkname. */
+  L->top -= 2;  /* Drop chunkname and template table cache. */
   lj_assertL(fs.prev == NULL && ls->fs == NULL, "mismatched frame nesting");
   lj_assertL(pt->sizeuv == 0, "toplevel proto has upvalues");
   return pt;
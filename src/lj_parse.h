@@ -10,6 +10,7 @@
 #include "lj_lex.h"
 
 LJ_FUNC GCproto *lj_parse(LexState *ls);
+LJ_FUNC void lj_parse_data(LexState *ls);
 LJ_FUNC GCstr *lj_parse_keepstr(LexState *ls, const char *str, size_t l);
 #if LJ_HASFFI
 LJ_FUNC void lj_parse_keepcdata(LexState *ls, TValue *tv, GCcdata *cd);
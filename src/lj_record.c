@@ -19,6 +19,7 @@
 #include "lj_ctype.h"
 #endif
 #include "lj_bc.h"
+#include "lj_bcdump.h"
 #include "lj_ff.h"
 #if LJ_HASPROFILE
 #include "lj_debug.h"
@@ -1322,7 +1323,7 @@ static void rec_idx_bump(jit_State *J, RecordIndex *ix)
 	J->retryrec = 1;  /* Abort the trace at the end of recording. */
       }
     } else if (ir->o == IR_TDUP) {
-      GCtab *tpl = gco2tab(proto_kgc(&gcref(rbc->pt)->pt, ~(ptrdiff_t)bc_d(*pc)));
+      GCtab *tpl = ir_ktab(IR(ir->op1));  /* TDUP or TDUPX. */
       /* Grow template table, but preserve keys with nil values. */
       if ((tb->asize > tpl->asize && (1u << nhbits)-1 == tpl->hmask) ||
 	  (tb->asize == tpl->asize && (1u << nhbits)-1 > tpl->hmask)) {
@@ -1487,6 +1488,23 @@ static int nommstr(jit_State *J, TRef key)
   return 1;  /* CANNOT be a metamethod name. */
 }
 
+/* Check that a store doesn't go to the shared storage of a table. */
+void lj_record_nocow(jit_State *J, TRef tr, GCtab *t)
+{
+  IRIns *ir = IR(tref_ref(tr));
+  if (ir->o == IR_TDUP) {
+    ir->op2 = 1;  /* Let asm_tdup() copy the template. */
+  } else if (ir->o != IR_TNEW && (J2G(J)->tabcow & TABCOW_USED)) {
+    if (tab_iscow(t)) {  /* Likely to be shared again on the next run. */
+      lj_ir_call(J, IRCALL_lj_tab_unshare, tr);
+      return;
+    }
+    tr = emitir(IRT(IR_FLOAD, IRT_U8), tr, IRFL_TAB_MARKED);
+    tr = emitir(IRTI(IR_BAND), tr, lj_ir_kint(J, LJ_TAB_COW));
+    emitir(IRTGI(IR_EQ), tr, lj_ir_kint(J, 0));
+  }
+}
+
 /* Record indexed load/store. */
 TRef lj_record_idx(jit_State *J, RecordIndex *ix)
 {
@@ -1548,6 +1566,9 @@ TRef lj_record_idx(jit_State *J, RecordIndex *ix)
     }
   }
 
+  if (ix->val)
+    lj_record_nocow(J, ix->tab, tabV(&ix->tabv));
+
   /* Record the key lookup. */
   xref = rec_idx_key(J, ix, &rbref, &rbguard);
   xrefop = IR(tref_ref(xref))->o;
@@ -1651,6 +1672,16 @@ static IRType rec_next_types(GCtab *t, uint32_t idx)
       return (LJ_DUALNUM ? IRT_INT : IRT_NUM) + (itype2irt(a) << 8);
   }
   idx -= t->asize;
+#if LJ_HASTABORD
+  if (tab_isord(t)) {
+    for (; idx < tab_ordcount(t); idx++) {
+      Node *n = &noderef(t->node)[tab_ordnode(t, idx)];
+      if (!tvisnil(&n->val))
+	return itype2irt(&n->key) + (itype2irt(&n->val) << 8);
+    }
+    return IRT_NIL + (IRT_NIL << 8);
+  }
+#endif
   for (; idx <= t->hmask; idx++) {
     Node *n = &noderef(t->node)[idx];
     if (!tvisnil(&n->val))
@@ -1708,6 +1739,31 @@ static void rec_tsetm(jit_State *J, BCReg ra, BCReg rn, int32_t i)
   }
 }
 
+/* Record TSETMR. The start index slot is advanced like for TINS. */
+static void rec_tsetmr(jit_State *J, RecordIndex *ix, BCReg ra, BCReg rn,
+		       BCReg rc)
+{
+  cTValue *basev = J->L->base;
+  TRef tr = ix->key, key = lj_opt_narrow_index(J, tr);
+  TValue keyv;
+  int32_t i = numberVint(&ix->keyv), n = (int32_t)(rn - ra), k;
+  copyTV(J->L, &keyv, &ix->keyv);
+  ix->idxchain = 0;
+  for (k = 0; k < n; k++) {
+    setintV(&ix->keyv, i+k);
+    ix->key = k ? emitir(IRTI(IR_ADD), key, lj_ir_kint(J, k)) : key;
+    copyTV(J->L, &ix->valv, &basev[ra+k]);
+    ix->val = getslot(J, ra+k);
+    lj_record_idx(J, ix);
+  }
+  if (n) {
+    TValue nv;
+    setintV(&nv, n);
+    J->base[rc] = lj_opt_narrow_arith(J, tr, lj_ir_kint(J, n), &keyv, &nv,
+				      IR_ADD);
+  }
+}
+
 /* -- Upvalue access ------------------------------------------------------ */
 
 /* Check whether upvalue is immutable and ok to constify. */
@@ -2238,11 +2294,13 @@ void lj_record_ins(jit_State *J)
   case BCMvar:
     copyTV(J->L, rcv, &lbase[rc]); ix.key = rc = getslot(J, rc); break;
   case BCMpri: setpriV(rcv, ~rc); ix.key = rc = TREF_PRI(IRT_NIL+rc); break;
-  case BCMnum: { cTValue *tv = proto_knumtv(J->pt, rc);
+  case BCMnum: if (bc_iswide(op)) break;  /* See below. */
+    { cTValue *tv = proto_knumtv(J->pt, rc);
     copyTV(J->L, rcv, tv); ix.key = rc = tvisint(tv) ? lj_ir_kint(J, intV(tv)) :
     tv->u32.hi == LJ_KEYINDEX ? (lj_ir_kint(J, 0) | TREF_KEYINDEX) :
     lj_ir_knumint(J, numV(tv)); } break;
-  case BCMstr: { GCstr *s = gco2str(proto_kgc(J->pt, ~(ptrdiff_t)rc));
+  case BCMstr: if (bc_iswide(op)) break;  /* See below. */
+    { GCstr *s = gco2str(proto_kgc(J->pt, ~(ptrdiff_t)rc));
     setstrV(J->L, rcv, s); ix.key = rc = lj_ir_kstr(J, s); } break;
   default: break;  /* Handled later. */
   }
@@ -2444,6 +2502,24 @@ void lj_record_ins(jit_State *J)
     break;
 #endif
 
+  /* -- Wide constant ops ------------------------------------------------- */
+
+  case BC_KSTRX:
+    rc = lj_ir_kstr(J, gco2str(proto_kgc(J->pt, ~(ptrdiff_t)bc_dx(pc))));
+    break;
+  case BC_KNUMX: {
+    cTValue *tv = proto_knumtv(J->pt, bc_dx(pc));
+    rc = tvisint(tv) ? lj_ir_kint(J, intV(tv)) : lj_ir_knumint(J, numV(tv));
+    break;
+    }
+#if LJ_HASFFI
+  case BC_KCDTX:
+    rc = lj_ir_kgc(J, proto_kgc(J->pt, ~(ptrdiff_t)bc_dx(pc)), IRT_CDATA);
+    break;
+#endif
+  case BC_NOP:
+    break;
+
   /* -- Upvalue and function ops ------------------------------------------ */
 
   case BC_UGET:
@@ -2455,6 +2531,12 @@ void lj_record_ins(jit_State *J)
 
   /* -- Table ops --------------------------------------------------------- */
 
+  case BC_GGETX: case BC_GSETX: {
+    GCstr *s = gco2str(proto_kgc(J->pt, ~(ptrdiff_t)bc_dx(pc)));
+    setstrV(J->L, &ix.keyv, s);
+    ix.key = lj_ir_kstr(J, s);
+    }
+    /* fallthrough */
   case BC_GGET: case BC_GSET:
     settabV(J->L, &ix.tabv, tabref(J->fn->l.env));
     ix.tab = emitir(IRT(IR_FLOAD, IRT_TAB), getcurrf(J), IRFL_FUNC_ENV);
@@ -2474,23 +2556,45 @@ void lj_record_ins(jit_State *J)
     ix.idxchain = 0;
     rc = lj_record_idx(J, &ix);
     break;
+  case BC_TINS: {
+    TRef key = ix.key;
+    TValue keyv, one;
+    copyTV(J->L, &keyv, &ix.keyv);
+    ix.idxchain = LJ_MAX_IDXCHAIN;
+    lj_record_idx(J, &ix);
+    setintV(&one, 1);  /* Post-increment the index slot. */
+    J->base[bc_c(ins)] = lj_opt_narrow_arith(J, key, lj_ir_kint(J, 1),
+					     &keyv, &one, IR_ADD);
+    break;
+    }
 
   case BC_TSETM:
     rec_tsetm(J, ra, (BCReg)(J->L->top - J->L->base), (int32_t)rcv->u32.lo);
     break;
+  case BC_TSTML:
+    rec_tsetm(J, ra, (BCReg)(J->L->top - J->L->base),
+	      (int32_t)proto_knumtv(J->pt, bc_dx(pc))->u32.lo);
+    break;
+  case BC_TSETMR:
+    rec_tsetmr(J, &ix, ra, (BCReg)(J->L->top - J->L->base), bc_c(ins));
+    break;
 
   case BC_TNEW:
     rc = rec_tnew(J, rc);
     break;
-  case BC_TDUP:
-    rc = emitir(IRTG(IR_TDUP, IRT_TAB),
-		lj_ir_ktab(J, gco2tab(proto_kgc(J->pt, ~(ptrdiff_t)rc))), 0);
+  case BC_TDUP: case BC_TDUPX: {
+    ptrdiff_t kidx = op == BC_TDUP ? (ptrdiff_t)rc : (ptrdiff_t)bc_dx(pc);
+    GCtab *kt = gco2tab(proto_kgc(J->pt, ~kidx));
+    if (tab_islazy(kt))  /* Loads from IR_TDUP are folded with the template. */
+      lj_bcread_ktab(J->L, kt);
+    rc = emitir(IRTG(IR_TDUP, IRT_TAB), lj_ir_ktab(J, kt), 0);
 #ifdef LUAJIT_ENABLE_TABLE_BUMP
     J->rbchash[(rc & (RBCHASH_SLOTS-1))].ref = tref_ref(rc);
     setmref(J->rbchash[(rc & (RBCHASH_SLOTS-1))].pc, pc);
     setgcref(J->rbchash[(rc & (RBCHASH_SLOTS-1))].pt, obj2gco(J->pt));
 #endif
     break;
+    }
 
   /* -- Calls and vararg handling ----------------------------------------- */
 
@@ -2625,7 +2729,7 @@ void lj_record_ins(jit_State *J)
     }
     /* fallthrough */
   case BC_UCLO:
-  case BC_FNEW:
+  case BC_FNEW: case BC_FNEWX:
     setintV(&J->errinfo, (int32_t)op);
     lj_trace_err_info(J, LJ_TRERR_NYIBC);
     break;
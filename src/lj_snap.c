@@ -296,8 +296,10 @@ static BCReg snap_usedef(jit_State *J, uint8_t *udf,
 	return maxslot;  /* NYI: punt. */
       } else if (op == BC_KNIL) {
 	for (s = bc_a(ins); s <= bc_d(ins); s++) DEF_SLOT(s);
-      } else if (op == BC_TSETM) {
+      } else if (op == BC_TSETM || op == BC_TSTML) {
 	for (s = bc_a(ins)-1; s < maxslot; s++) USE_SLOT(s);
+      } else if (op == BC_TSETMR) {
+	for (s = bc_a(ins); s < maxslot; s++) USE_SLOT(s);
       }
       break;
     default: break;
@@ -983,7 +985,8 @@ const BCIns *lj_snap_restore(jit_State *J, void *exptr)
       break;
     }
     /* fallthrough */
-  case BC_CALLM: case BC_CALLMT: case BC_RETM: case BC_TSETM:
+  case BC_CALLM: case BC_CALLMT: case BC_RETM:
+  case BC_TSETM: case BC_TSTML: case BC_TSETMR:
     L->top = frame + snap->nslots;
     break;
   }
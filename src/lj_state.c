@@ -27,6 +27,7 @@
 #include "lj_vm.h"
 #include "lj_prng.h"
 #include "lj_lex.h"
+#include "lj_bcdump.h"
 #include "lj_alloc.h"
 #include "luajit.h"
 
@@ -172,6 +173,7 @@ static void close_state(lua_State *L)
 #if LJ_HASFFI
   lj_ctype_freestate(g);
 #endif
+  lj_load_freestate(g);
   lj_str_freetab(g);
   lj_buf_free(g, &g->tmpbuf);
   lj_mem_freevec(g, tvref(L->stack), L->stacksize, TValue);
@@ -25,10 +25,10 @@
 
 static const uint8_t strfmt_map[('x'-'A')+1] = {
   STRFMT_A,0,0,0,STRFMT_E,STRFMT_F,STRFMT_G,0,0,0,0,0,0,
-  0,0,0,0,0,0,0,0,0,0,STRFMT_X,0,0,
+  0,0,0,0,STRFMT_R,0,0,0,0,0,STRFMT_X,0,0,
   0,0,0,0,0,0,
   STRFMT_A,0,STRFMT_C,STRFMT_D,STRFMT_E,STRFMT_F,STRFMT_G,0,STRFMT_I,0,0,0,0,
-  0,STRFMT_O,STRFMT_P,STRFMT_Q,0,STRFMT_S,0,STRFMT_U,0,0,STRFMT_X
+  0,STRFMT_O,STRFMT_P,STRFMT_Q,STRFMT_R,STRFMT_S,0,STRFMT_U,0,0,STRFMT_X
 };
 
 SFormat LJ_FASTCALL lj_strfmt_parse(FormatState *fs)
@@ -174,7 +174,7 @@ const char *lj_strfmt_wstrnum(lua_State *L, cTValue *o, MSize *lenp)
   } else if (tvisint(o)) {
     sb = lj_strfmt_putint(lj_buf_tmp_(L), intV(o));
   } else if (tvisnum(o)) {
-    sb = lj_strfmt_putfnum(lj_buf_tmp_(L), STRFMT_G14, o->n);
+    sb = lj_strfmt_putfnum(lj_buf_tmp_(L), STRFMT_TOSTR(G(L)), o->n);
   } else {
     return NULL;
   }
@@ -195,7 +195,7 @@ SBuf * LJ_FASTCALL lj_strfmt_putint(SBuf *sb, int32_t k)
 /* Add number to buffer. */
 SBuf * LJ_FASTCALL lj_strfmt_putnum(SBuf *sb, cTValue *o)
 {
-  return lj_strfmt_putfnum(sb, STRFMT_G14, o->n);
+  return lj_strfmt_putfnum(sb, STRFMT_TOSTR(G(sbufL(sb))), o->n);
 }
 #endif
 
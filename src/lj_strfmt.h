@@ -31,6 +31,7 @@ typedef enum FormatType {
 #define STRFMT_T_FP_E	0x0010	/* STRFMT_NUM */
 #define STRFMT_T_FP_F	0x0020	/* STRFMT_NUM */
 #define STRFMT_T_FP_G	0x0030	/* STRFMT_NUM */
+#define STRFMT_T_FP_R	0x0040	/* STRFMT_NUM, shortest round-trip */
 #define STRFMT_T_QUOTED	0x0010	/* STRFMT_STR */
 
 /* Format flags. */
@@ -61,15 +62,19 @@ typedef enum FormatType {
 #define STRFMT_O	(STRFMT_UINT|STRFMT_T_OCT)
 #define STRFMT_P	(STRFMT_PTR)
 #define STRFMT_Q	(STRFMT_STR|STRFMT_T_QUOTED)
+#define STRFMT_R	(STRFMT_G|STRFMT_T_FP_R)
 #define STRFMT_S	(STRFMT_STR)
 #define STRFMT_U	(STRFMT_UINT)
 #define STRFMT_X	(STRFMT_UINT|STRFMT_T_HEX)
 #define STRFMT_G14	(STRFMT_G | ((14+1) << STRFMT_SH_PREC))
 
+/* Format for number to string conversions (see LUAJIT_MODE_NUMFMT). */
+#define STRFMT_TOSTR(g)	((g)->str.numfmt ? STRFMT_R : STRFMT_G14)
+
 /* Maximum buffer sizes for conversions. */
 #define STRFMT_MAXBUF_XINT	(1+22)  /* '0' prefix + uint64_t in octal. */
 #define STRFMT_MAXBUF_INT	(1+10)  /* Sign + int32_t in decimal. */
-#define STRFMT_MAXBUF_NUM	32  /* Must correspond with STRFMT_G14. */
+#define STRFMT_MAXBUF_NUM	32  /* Must correspond with STRFMT_G14/R. */
 #define STRFMT_MAXBUF_PTR	(2+2*sizeof(ptrdiff_t))  /* "0x" + hex ptr. */
 
 /* Format parser. */
@@ -263,6 +263,222 @@ static int nd_similar(uint32_t* nd, uint32_t ndhi, uint32_t* ref, MSize hilen,
   return !memcmp(nd9, ref9, prec) && (nd9[prec] < '5') == (ref9[prec] < '5');
 }
 
+/* -- Shortest round-trip digits ------------------------------------------ */
+
+/*
+** The %r conversion uses the Ryu algorithm by Ulf Adams to find the
+** shortest digit string which converts back to the same number. If there
+** are several, the one closest to the exact value is chosen. The scaled
+** powers of five are computed from a few table entries to keep it small.
+*/
+
+#define RYU_POW5_BITS	125
+#define RYU_POW5_TABSZ	26
+
+/* 5^k for k = 0 through RYU_POW5_TABSZ-1. */
+static const uint64_t ryu_pow5[RYU_POW5_TABSZ] = {
+  U64x(00000000,00000001), U64x(00000000,00000005), U64x(00000000,00000019),
+  U64x(00000000,0000007d), U64x(00000000,00000271), U64x(00000000,00000c35),
+  U64x(00000000,00003d09), U64x(00000000,0001312d), U64x(00000000,0005f5e1),
+  U64x(00000000,001dcd65), U64x(00000000,009502f9), U64x(00000000,02e90edd),
+  U64x(00000000,0e8d4a51), U64x(00000000,48c27395), U64x(00000001,6bcc41e9),
+  U64x(00000007,1afd498d), U64x(00000023,86f26fc1), U64x(000000b1,a2bc2ec5),
+  U64x(00000378,2dace9d9), U64x(00001158,e460913d), U64x(000056bc,75e2d631),
+  U64x(0001b1ae,4d6e2ef5), U64x(00087867,8326eac9), U64x(002a5a05,8fc295ed),
+  U64x(00d3c21b,cecceda1), U64x(0422ca8b,0a00a425)
+};
+
+/* 5^(26*k) and 2^j/5^(26*k), normalized to RYU_POW5_BITS. Low, high. */
+static const uint64_t ryu_pow5_split[13][2] = {
+  { U64x(00000000,00000000), U64x(10000000,00000000) },
+  { U64x(00000000,00000000), U64x(14adf4b7,320334b9) },
+  { U64x(0e549208,b31adb10), U64x(1aba4714,957d300d) },
+  { U64x(6dc6ad26,4d8f0866), U64x(1145b7e2,85bf98f5) },
+  { U64x(eb1dbd92,3d8596ca), U64x(1652efdc,6018a1fc) },
+  { U64x(b4c1b80b,22ae923c), U64x(1cda6205,5b2d9d83) },
+  { U64x(5bb28b4e,8f7e4c30), U64x(12a5568b,9f52f416) },
+  { U64x(f08aed43,7682d4fb), U64x(18196515,31f9e78f) },
+  { U64x(b4ee134a,d99bf150), U64x(1f25c186,a6f04c28) },
+  { U64x(16499ecb,70c25f03), U64x(1420eb44,9c8842e6) },
+  { U64x(85a56ead,360865b0), U64x(1a03fde2,14caf085) },
+  { U64x(093db1d5,7999890b), U64x(10cfeb35,3a97dad8) },
+  { U64x(cf38bb73,5e3f36ac), U64x(15baaf44,fa52673e) }
+};
+
+static const uint64_t ryu_pow5_inv[15][2] = {
+  { U64x(00000000,00000001), U64x(20000000,00000000) },
+  { U64x(52a6c95f,c0655034), U64x(18c240c4,aecb13bb) },
+  { U64x(7ca8d500,71dfc806), U64x(1327fc58,da0f6ff5) },
+  { U64x(6520247d,3556476e), U64x(1da48ce4,68e7c702) },
+  { U64x(6139cdd7,6802e6e9), U64x(16ef5b40,c2fc7779) },
+  { U64x(f951a7ff,43de8c79), U64x(11bebdf5,78b2f391) },
+  { U64x(7be8bee8,d6e957e8), U64x(1b758d84,8fac54b0) },
+  { U64x(8bd3f9e9,99a423ea), U64x(153eda61,4071a3b7) },
+  { U64x(0848f973,cb3ee3ce), U64x(10701bd5,27b4978c) },
+  { U64x(153285eb,b9efbfa2), U64x(196fbb9b,b44db44d) },
+  { U64x(adeee7f8,6c07b696), U64x(13ae3591,f5b4d936) },
+  { U64x(4d686a4e,af182222), U64x(1e74404f,3daada91) },
+  { U64x(98c0a106,e09ebd9f), U64x(17900ea4,fda7c257) },
+  { U64x(8f20e373,71497d0e), U64x(123b1405,76d820b2) },
+  { U64x(b0431381,34743d85), U64x(1c35f427,5f7a29ad) }
+};
+
+/* Rounding corrections for interpolated entries, 2 bits each. */
+static const uint32_t ryu_pow5_ofs[] = {
+  0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x40000000, 0x59695995,
+  0x55545555, 0x56555515, 0x41150504, 0x40555410, 0x44555145, 0x44504540,
+  0x45555550, 0x40004000, 0x96440440, 0x55565565, 0x54454045, 0x40154151,
+  0x55559155, 0x51405555, 0x00000105
+};
+
+static const uint32_t ryu_pow5_invofs[] = {
+  0x54544554, 0x04055545, 0x10041000, 0x00400414, 0x40010000, 0x41155555,
+  0x00000454, 0x00010044, 0x40000000, 0x44000041, 0x50454450, 0x55550054,
+  0x51655554, 0x40004000, 0x01000001, 0x00010500, 0x51515411, 0x05555554,
+  0x50411500, 0x40040000, 0x05040110, 0x00000000
+};
+
+/* 64 x 64 -> 128 bit multiplication. Returns low part, stores high part. */
+static LJ_AINLINE uint64_t ryu_mul128(uint64_t a, uint64_t b, uint64_t *hi)
+{
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__SIZEOF_INT128__)
+  unsigned __int128 r = (unsigned __int128)a * b;
+  *hi = (uint64_t)(r >> 64);
+  return (uint64_t)r;
+#else
+  uint64_t al = (uint32_t)a, ah = a >> 32, bl = (uint32_t)b, bh = b >> 32;
+  uint64_t ll = al*bl, lh = al*bh, hl = ah*bl;
+  uint64_t mid = (ll >> 32) + (uint32_t)lh + (uint32_t)hl;
+  *hi = ah*bh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+  return (mid << 32) | (uint32_t)ll;
+#endif
+}
+
+/* Shift 128 bit value right by 0 < n < 64 bits. */
+#define ryu_shr128(lo, hi, n)	(((hi) << (64 - (n))) | ((lo) >> (n)))
+
+/* ceil(log2(5^e)) for e > 0, 1 for e = 0. */
+#define ryu_pow5bits(e)		((int32_t)((((uint32_t)(e)*1217359) >> 19) + 1))
+
+/* Compute 5^i or 2^j/5^i, normalized to RYU_POW5_BITS. */
+static void ryu_pow5split(int32_t i, int inv, uint64_t *r)
+{
+  int32_t base = inv ? (i + RYU_POW5_TABSZ-1) / RYU_POW5_TABSZ :
+		       i / RYU_POW5_TABSZ;
+  int32_t base2 = base * RYU_POW5_TABSZ, d;
+  const uint64_t *mul = inv ? ryu_pow5_inv[base] : ryu_pow5_split[base];
+  uint64_t m, lo0, hi0, lo1, hi1, sum;
+  const uint32_t *ofs = inv ? ryu_pow5_invofs : ryu_pow5_ofs;
+  if (i == base2) {
+    r[0] = mul[0]; r[1] = mul[1];
+    return;
+  }
+  m = ryu_pow5[inv ? base2 - i : i - base2];
+  lo1 = ryu_mul128(m, mul[1], &hi1);
+  lo0 = ryu_mul128(m, mul[0] - (uint64_t)inv, &hi0);
+  sum = hi0 + lo1;
+  if (sum < hi0) hi1++;
+  d = inv ? ryu_pow5bits(base2) - ryu_pow5bits(i) :
+	    ryu_pow5bits(i) - ryu_pow5bits(base2);
+  r[0] = ryu_shr128(lo0, sum, d) + (uint64_t)inv +
+	 ((ofs[i >> 4] >> ((i & 15) << 1)) & 3);
+  r[1] = ryu_shr128(sum, hi1, d);
+}
+
+/* Compute (m * mul) >> j for a 55 bit m and j >= 64. */
+static uint64_t ryu_mulshift(uint64_t m, const uint64_t *mul, int32_t j)
+{
+  uint64_t hi0, hi1, lo1 = ryu_mul128(m, mul[1], &hi1), sum;
+  ryu_mul128(m, mul[0], &hi0);
+  sum = hi0 + lo1;
+  if (sum < hi0) hi1++;
+  return ryu_shr128(sum, hi1, j - 64);
+}
+
+/* Check whether x is a multiple of 5^p. */
+static int ryu_ismul5(uint64_t x, int32_t p)
+{
+  int32_t n = 0;
+  while (x % 5 == 0) x /= 5, n++;
+  return n >= p;
+}
+
+/*
+** Compute the shortest decimal digits m of a finite non-zero number with
+** abs(n) = m * 10^*ep.
+*/
+static uint64_t ryu_digits(TValue t, int32_t *ep)
+{
+  uint64_t m2 = t.u64 & U64x(000fffff,ffffffff), mv, vr, vp, vm, pw[2];
+  int32_t e2 = (t.u32.hi >> 20) & 0x7ff, e10, removed = 0;
+  int accept, vmzero = 0, vrzero = 0;
+  uint32_t mmshift = m2 != 0 || e2 <= 1, last = 0;
+  if (e2) m2 |= U64x(00100000,00000000), e2 -= 1075+2; else e2 = 1-1075-2;
+  accept = !(m2 & 1);  /* Boundaries round to even, so they are included. */
+  mv = 4 * m2;
+  /* Scale mv and its boundaries by a power of ten. */
+  if (e2 >= 0) {
+    int32_t q = (int32_t)(((uint32_t)e2 * 78913) >> 18) - (e2 > 3);
+    int32_t j = -e2 + q + RYU_POW5_BITS + ryu_pow5bits(q) - 1;
+    ryu_pow5split(q, 1, pw);
+    e10 = q;
+    vr = ryu_mulshift(mv, pw, j);
+    vp = ryu_mulshift(mv + 2, pw, j);
+    vm = ryu_mulshift(mv - 1 - mmshift, pw, j);
+    if (q <= 21) {  /* Check for trailing zeros of the exact values. */
+      if (mv % 5 == 0) vrzero = ryu_ismul5(mv, q);
+      else if (accept) vmzero = ryu_ismul5(mv - 1 - mmshift, q);
+      else vp -= ryu_ismul5(mv + 2, q);
+    }
+  } else {
+    int32_t q = (int32_t)(((uint32_t)-e2 * 732923) >> 20) - (-e2 > 1);
+    int32_t i = -e2 - q;
+    int32_t j = q - (ryu_pow5bits(i) - RYU_POW5_BITS);
+    ryu_pow5split(i, 0, pw);
+    e10 = q + e2;
+    vr = ryu_mulshift(mv, pw, j);
+    vp = ryu_mulshift(mv + 2, pw, j);
+    vm = ryu_mulshift(mv - 1 - mmshift, pw, j);
+    if (q <= 1) {
+      vrzero = 1;
+      if (accept) vmzero = mmshift == 1; else vp--;
+    } else if (q < 63) {
+      vrzero = (mv & (((uint64_t)1 << q) - 1)) == 0;
+    }
+  }
+  /* Remove digits while both boundaries still differ. */
+  if (vmzero || vrzero) {  /* Rare general case. */
+    for (; vp / 10 > vm / 10; removed++) {
+      vmzero &= vm % 10 == 0;
+      vrzero &= last == 0;
+      last = (uint32_t)(vr % 10);
+      vr /= 10; vp /= 10; vm /= 10;
+    }
+    if (vmzero) {
+      for (; vm % 10 == 0; removed++) {
+	vrzero &= last == 0;
+	last = (uint32_t)(vr % 10);
+	vr /= 10; vp /= 10; vm /= 10;
+      }
+    }
+    if (vrzero && last == 5 && !(vr & 1)) last = 4;  /* Round to even. */
+    vr += ((vr == vm && (!accept || !vmzero)) || last >= 5);
+  } else {
+    if (vp / 100 > vm / 100) {  /* Usually at least two digits go. */
+      last = (uint32_t)(vr % 100) >= 50 ? 5 : 0;
+      vr /= 100; vp /= 100; vm /= 100;
+      removed += 2;
+    }
+    for (; vp / 10 > vm / 10; removed++) {
+      last = (uint32_t)(vr % 10);
+      vr /= 10; vp /= 10; vm /= 10;
+    }
+    vr += (vr == vm || last >= 5);
+  }
+  *ep = e10 + removed;
+  return vr;
+}
+
 /* -- Formatted conversions to buffer ------------------------------------- */
 
 /* Write formatted floating-point number to either sb or p. */
@@ -288,6 +504,64 @@ static char *lj_strfmt_wfnum(SBuf *sb, SFormat sf, lua_Number n, char *p)
     if (!(sf & STRFMT_F_LEFT)) while (width-- > len) *p++ = ' ';
     if (prefix) *p++ = prefix;
     *p++ = (char)(ch >> 16); *p++ = (char)(ch >> 8); *p++ = (char)ch;
+  } else if ((sf & STRFMT_T_FP_R)) {
+    /* %r - shortest digits which convert back to the same number. */
+    char dig[24], *q = dig, prefix = 0;
+    int32_t k = 0, nde;
+    MSize ndig;
+    if (t.u32.hi & 0x80000000) prefix = '-';
+    else if ((sf & STRFMT_F_PLUS)) prefix = '+';
+    else if ((sf & STRFMT_F_SPACE)) prefix = ' ';
+    if ((t.u64 << 1)) {
+      uint64_t m = ryu_digits(t, &k);
+      if (m >= 1000000000) {
+	q = lj_strfmt_wint(q, (int32_t)(m / 1000000000));
+	q = lj_strfmt_wuint9(q, (uint32_t)(m % 1000000000));
+      } else {
+	q = lj_strfmt_wint(q, (int32_t)m);
+      }
+    } else {
+      *q++ = '0';
+    }
+    ndig = (MSize)(q - dig);
+    nde = (int32_t)ndig + k - 1;  /* Exponent of the leading digit. */
+    if (nde >= -4 && nde < 17) {  /* Like %.17g, use %f style. */
+      len = nde < 0 ? ndig + 1 - nde :
+	    (int32_t)ndig > nde+1 ? ndig + 1 : (MSize)nde + 1;
+    } else {
+      len = ndig + (ndig > 1) + 4 + (nde <= -100 || nde >= 100);
+    }
+    len += (prefix != 0);
+    if (!p) p = lj_buf_more(sb, width > len ? width : len);
+    if (!(sf & (STRFMT_F_LEFT | STRFMT_F_ZERO))) {
+      while (width-- > len) *p++ = ' ';
+    }
+    if (prefix) *p++ = prefix;
+    if ((sf & (STRFMT_F_LEFT | STRFMT_F_ZERO)) == STRFMT_F_ZERO) {
+      while (width-- > len) *p++ = '0';
+    }
+    q = dig;
+    if (nde < -4 || nde >= 17) {
+      *p++ = *q++;
+      if (ndig > 1) {
+	*p++ = '.';
+	while (q < dig + ndig) *p++ = *q++;
+      }
+      *p++ = (sf & STRFMT_F_UPPER) ? 'E' : 'e';
+      if (nde < 0) { *p++ = '-'; nde = -nde; } else { *p++ = '+'; }
+      if (nde < 10) *p++ = '0';  /* Always at least two digits of exponent. */
+      p = lj_strfmt_wint(p, nde);
+    } else if (nde < 0) {
+      *p++ = '0'; *p++ = '.';
+      while (++nde < 0) *p++ = '0';
+      while (q < dig + ndig) *p++ = *q++;
+    } else {
+      for (; nde >= 0; nde--) *p++ = q < dig + ndig ? *q++ : '0';
+      if (q < dig + ndig) {
+	*p++ = '.';
+	while (q < dig + ndig) *p++ = *q++;
+      }
+    }
   } else if (STRFMT_FP(sf) == STRFMT_FP(STRFMT_T_FP_A)) {
     /* %a */
     const char *hexdig = (sf & STRFMT_F_UPPER) ? "0123456789ABCDEFPX"
@@ -586,7 +860,8 @@ SBuf *lj_strfmt_putfnum(SBuf *sb, SFormat sf, lua_Number n)
 GCstr * LJ_FASTCALL lj_strfmt_num(lua_State *L, cTValue *o)
 {
   char buf[STRFMT_MAXBUF_NUM];
-  MSize len = (MSize)(lj_strfmt_wfnum(NULL, STRFMT_G14, o->n, buf) - buf);
+  MSize len = (MSize)(lj_strfmt_wfnum(NULL, STRFMT_TOSTR(G(L)), o->n, buf) -
+		      buf);
   return lj_str_new(L, buf, len);
 }
 
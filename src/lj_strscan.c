@@ -72,6 +72,272 @@
 
 #define casecmp(c, k)	(((c) | 0x20) == k)
 
+/*
+** Decimal numbers with up to 19 significant digits and a small exponent
+** are converted with the Eisel-Lemire algorithm: the digits are multiplied
+** with a 128 bit truncated approximation of 10^ex. This gives the exactly
+** rounded result, unless the truncation error might affect the rounding,
+** which is detected and left to the exact parser.
+*/
+
+#define STRSCAN_P5MIN	(-96)
+#define STRSCAN_P5MAX	96
+
+/* Normalized 128 bit approximations of 5^q for q = STRSCAN_P5MIN..MAX. */
+static const uint64_t strscan_pow5[STRSCAN_P5MAX-STRSCAN_P5MIN+1][2] = {
+  { U64x(88b402f7,fd75539b), U64x(11dbcb02,18ebb414) },
+  { U64x(aae103b5,fcd2a881), U64x(d652bdc2,9f26a119) },
+  { U64x(d59944a3,7c0752a2), U64x(4be76d33,46f0495f) },
+  { U64x(857fcae6,2d8493a5), U64x(6f70a440,0c562ddb) },
+  { U64x(a6dfbd9f,b8e5b88e), U64x(cb4ccd50,0f6bb952) },
+  { U64x(d097ad07,a71f26b2), U64x(7e2000a4,1346a7a7) },
+  { U64x(825ecc24,c873782f), U64x(8ed40066,8c0c28c8) },
+  { U64x(a2f67f2d,fa90563b), U64x(72890080,2f0f32fa) },
+  { U64x(cbb41ef9,79346bca), U64x(4f2b40a0,3ad2ffb9) },
+  { U64x(fea126b7,d78186bc), U64x(e2f610c8,4987bfa8) },
+  { U64x(9f24b832,e6b0f436), U64x(0dd9ca7d,2df4d7c9) },
+  { U64x(c6ede63f,a05d3143), U64x(91503d1c,79720dbb) },
+  { U64x(f8a95fcf,88747d94), U64x(75a44c63,97ce912a) },
+  { U64x(9b69dbe1,b548ce7c), U64x(c986afbe,3ee11aba) },
+  { U64x(c24452da,229b021b), U64x(fbe85bad,ce996168) },
+  { U64x(f2d56790,ab41c2a2), U64x(fae27299,423fb9c3) },
+  { U64x(97c560ba,6b0919a5), U64x(dccd879f,c967d41a) },
+  { U64x(bdb6b8e9,05cb600f), U64x(5400e987,bbc1c920) },
+  { U64x(ed246723,473e3813), U64x(290123e9,aab23b68) },
+  { U64x(9436c076,0c86e30b), U64x(f9a0b672,0aaf6521) },
+  { U64x(b9447093,8fa89bce), U64x(f808e40e,8d5b3e69) },
+  { U64x(e7958cb8,7392c2c2), U64x(b60b1d12,30b20e04) },
+  { U64x(90bd77f3,483bb9b9), U64x(b1c6f22b,5e6f48c2) },
+  { U64x(b4ecd5f0,1a4aa828), U64x(1e38aeb6,360b1af3) },
+  { U64x(e2280b6c,20dd5232), U64x(25c6da63,c38de1b0) },
+  { U64x(8d590723,948a535f), U64x(579c487e,5a38ad0e) },
+  { U64x(b0af48ec,79ace837), U64x(2d835a9d,f0c6d851) },
+  { U64x(dcdb1b27,98182244), U64x(f8e43145,6cf88e65) },
+  { U64x(8a08f0f8,bf0f156b), U64x(1b8e9ecb,641b58ff) },
+  { U64x(ac8b2d36,eed2dac5), U64x(e272467e,3d222f3f) },
+  { U64x(d7adf884,aa879177), U64x(5b0ed81d,cc6abb0f) },
+  { U64x(86ccbb52,ea94baea), U64x(98e94712,9fc2b4e9) },
+  { U64x(a87fea27,a539e9a5), U64x(3f2398d7,47b36224) },
+  { U64x(d29fe4b1,8e88640e), U64x(8eec7f0d,19a03aad) },
+  { U64x(83a3eeee,f9153e89), U64x(1953cf68,300424ac) },
+  { U64x(a48ceaaa,b75a8e2b), U64x(5fa8c342,3c052dd7) },
+  { U64x(cdb02555,653131b6), U64x(3792f412,cb06794d) },
+  { U64x(808e1755,5f3ebf11), U64x(e2bbd88b,bee40bd0) },
+  { U64x(a0b19d2a,b70e6ed6), U64x(5b6aceae,ae9d0ec4) },
+  { U64x(c8de0475,64d20a8b), U64x(f245825a,5a445275) },
+  { U64x(fb158592,be068d2e), U64x(eed6e2f0,f0d56712) },
+  { U64x(9ced737b,b6c4183d), U64x(55464dd6,9685606b) },
+  { U64x(c428d05a,a4751e4c), U64x(aa97e14c,3c26b886) },
+  { U64x(f5330471,4d9265df), U64x(d53dd99f,4b3066a8) },
+  { U64x(993fe2c6,d07b7fab), U64x(e546a803,8efe4029) },
+  { U64x(bf8fdb78,849a5f96), U64x(de985204,72bdd033) },
+  { U64x(ef73d256,a5c0f77c), U64x(963e6685,8f6d4440) },
+  { U64x(95a86376,27989aad), U64x(dde70013,79a44aa8) },
+  { U64x(bb127c53,b17ec159), U64x(5560c018,580d5d52) },
+  { U64x(e9d71b68,9dde71af), U64x(aab8f01e,6e10b4a6) },
+  { U64x(92267121,62ab070d), U64x(cab39613,04ca70e8) },
+  { U64x(b6b00d69,bb55c8d1), U64x(3d607b97,c5fd0d22) },
+  { U64x(e45c10c4,2a2b3b05), U64x(8cb89a7d,b77c506a) },
+  { U64x(8eb98a7a,9a5b04e3), U64x(77f3608e,92adb242) },
+  { U64x(b267ed19,40f1c61c), U64x(55f038b2,37591ed3) },
+  { U64x(df01e85f,912e37a3), U64x(6b6c46de,c52f6688) },
+  { U64x(8b61313b,babce2c6), U64x(2323ac4b,3b3da015) },
+  { U64x(ae397d8a,a96c1b77), U64x(abec975e,0a0d081a) },
+  { U64x(d9c7dced,53c72255), U64x(96e7bd35,8c904a21) },
+  { U64x(881cea14,545c7575), U64x(7e50d641,77da2e54) },
+  { U64x(aa242499,697392d2), U64x(dde50bd1,d5d0b9e9) },
+  { U64x(d4ad2dbf,c3d07787), U64x(955e4ec6,4b44e864) },
+  { U64x(84ec3c97,da624ab4), U64x(bd5af13b,ef0b113e) },
+  { U64x(a6274bbd,d0fadd61), U64x(ecb1ad8a,eacdd58e) },
+  { U64x(cfb11ead,453994ba), U64x(67de18ed,a5814af2) },
+  { U64x(81ceb32c,4b43fcf4), U64x(80eacf94,8770ced7) },
+  { U64x(a2425ff7,5e14fc31), U64x(a1258379,a94d028d) },
+  { U64x(cad2f7f5,359a3b3e), U64x(096ee458,13a04330) },
+  { U64x(fd87b5f2,8300ca0d), U64x(8bca9d6e,188853fc) },
+  { U64x(9e74d1b7,91e07e48), U64x(775ea264,cf55347e) },
+  { U64x(c6120625,76589dda), U64x(95364afe,032a819e) },
+  { U64x(f79687ae,d3eec551), U64x(3a83ddbd,83f52205) },
+  { U64x(9abe14cd,44753b52), U64x(c4926a96,72793543) },
+  { U64x(c16d9a00,95928a27), U64x(75b7053c,0f178294) },
+  { U64x(f1c90080,baf72cb1), U64x(5324c68b,12dd6339) },
+  { U64x(971da050,74da7bee), U64x(d3f6fc16,ebca5e04) },
+  { U64x(bce50864,92111aea), U64x(88f4bb1c,a6bcf585) },
+  { U64x(ec1e4a7d,b69561a5), U64x(2b31e9e3,d06c32e6) },
+  { U64x(9392ee8e,921d5d07), U64x(3aff322e,62439fd0) },
+  { U64x(b877aa32,36a4b449), U64x(09befeb9,fad487c3) },
+  { U64x(e69594be,c44de15b), U64x(4c2ebe68,7989a9b4) },
+  { U64x(901d7cf7,3ab0acd9), U64x(0f9d3701,4bf60a11) },
+  { U64x(b424dc35,095cd80f), U64x(538484c1,9ef38c95) },
+  { U64x(e12e1342,4bb40e13), U64x(2865a5f2,06b06fba) },
+  { U64x(8cbccc09,6f5088cb), U64x(f93f87b7,442e45d4) },
+  { U64x(afebff0b,cb24aafe), U64x(f78f69a5,1539d749) },
+  { U64x(dbe6fece,bdedd5be), U64x(b573440e,5a884d1c) },
+  { U64x(89705f41,36b4a597), U64x(31680a88,f8953031) },
+  { U64x(abcc7711,8461cefc), U64x(fdc20d2b,36ba7c3e) },
+  { U64x(d6bf94d5,e57a42bc), U64x(3d329076,04691b4d) },
+  { U64x(8637bd05,af6c69b5), U64x(a63f9a49,c2c1b110) },
+  { U64x(a7c5ac47,1b478423), U64x(0fcf80dc,33721d54) },
+  { U64x(d1b71758,e219652b), U64x(d3c36113,404ea4a9) },
+  { U64x(83126e97,8d4fdf3b), U64x(645a1cac,083126ea) },
+  { U64x(a3d70a3d,70a3d70a), U64x(3d70a3d7,0a3d70a4) },
+  { U64x(cccccccc,cccccccc), U64x(cccccccc,cccccccd) },
+  { U64x(80000000,00000000), U64x(00000000,00000000) },
+  { U64x(a0000000,00000000), U64x(00000000,00000000) },
+  { U64x(c8000000,00000000), U64x(00000000,00000000) },
+  { U64x(fa000000,00000000), U64x(00000000,00000000) },
+  { U64x(9c400000,00000000), U64x(00000000,00000000) },
+  { U64x(c3500000,00000000), U64x(00000000,00000000) },
+  { U64x(f4240000,00000000), U64x(00000000,00000000) },
+  { U64x(98968000,00000000), U64x(00000000,00000000) },
+  { U64x(bebc2000,00000000), U64x(00000000,00000000) },
+  { U64x(ee6b2800,00000000), U64x(00000000,00000000) },
+  { U64x(9502f900,00000000), U64x(00000000,00000000) },
+  { U64x(ba43b740,00000000), U64x(00000000,00000000) },
+  { U64x(e8d4a510,00000000), U64x(00000000,00000000) },
+  { U64x(9184e72a,00000000), U64x(00000000,00000000) },
+  { U64x(b5e620f4,80000000), U64x(00000000,00000000) },
+  { U64x(e35fa931,a0000000), U64x(00000000,00000000) },
+  { U64x(8e1bc9bf,04000000), U64x(00000000,00000000) },
+  { U64x(b1a2bc2e,c5000000), U64x(00000000,00000000) },
+  { U64x(de0b6b3a,76400000), U64x(00000000,00000000) },
+  { U64x(8ac72304,89e80000), U64x(00000000,00000000) },
+  { U64x(ad78ebc5,ac620000), U64x(00000000,00000000) },
+  { U64x(d8d726b7,177a8000), U64x(00000000,00000000) },
+  { U64x(87867832,6eac9000), U64x(00000000,00000000) },
+  { U64x(a968163f,0a57b400), U64x(00000000,00000000) },
+  { U64x(d3c21bce,cceda100), U64x(00000000,00000000) },
+  { U64x(84595161,401484a0), U64x(00000000,00000000) },
+  { U64x(a56fa5b9,9019a5c8), U64x(00000000,00000000) },
+  { U64x(cecb8f27,f4200f3a), U64x(00000000,00000000) },
+  { U64x(813f3978,f8940984), U64x(40000000,00000000) },
+  { U64x(a18f07d7,36b90be5), U64x(50000000,00000000) },
+  { U64x(c9f2c9cd,04674ede), U64x(a4000000,00000000) },
+  { U64x(fc6f7c40,45812296), U64x(4d000000,00000000) },
+  { U64x(9dc5ada8,2b70b59d), U64x(f0200000,00000000) },
+  { U64x(c5371912,364ce305), U64x(6c280000,00000000) },
+  { U64x(f684df56,c3e01bc6), U64x(c7320000,00000000) },
+  { U64x(9a130b96,3a6c115c), U64x(3c7f4000,00000000) },
+  { U64x(c097ce7b,c90715b3), U64x(4b9f1000,00000000) },
+  { U64x(f0bdc21a,bb48db20), U64x(1e86d400,00000000) },
+  { U64x(96769950,b50d88f4), U64x(13144480,00000000) },
+  { U64x(bc143fa4,e250eb31), U64x(17d955a0,00000000) },
+  { U64x(eb194f8e,1ae525fd), U64x(5dcfab08,00000000) },
+  { U64x(92efd1b8,d0cf37be), U64x(5aa1cae5,00000000) },
+  { U64x(b7abc627,050305ad), U64x(f14a3d9e,40000000) },
+  { U64x(e596b7b0,c643c719), U64x(6d9ccd05,d0000000) },
+  { U64x(8f7e32ce,7bea5c6f), U64x(e4820023,a2000000) },
+  { U64x(b35dbf82,1ae4f38b), U64x(dda2802c,8a800000) },
+  { U64x(e0352f62,a19e306e), U64x(d50b2037,ad200000) },
+  { U64x(8c213d9d,a502de45), U64x(4526f422,cc340000) },
+  { U64x(af298d05,0e4395d6), U64x(9670b12b,7f410000) },
+  { U64x(daf3f046,51d47b4c), U64x(3c0cdd76,5f114000) },
+  { U64x(88d8762b,f324cd0f), U64x(a5880a69,fb6ac800) },
+  { U64x(ab0e93b6,efee0053), U64x(8eea0d04,7a457a00) },
+  { U64x(d5d238a4,abe98068), U64x(72a49045,98d6d880) },
+  { U64x(85a36366,eb71f041), U64x(47a6da2b,7f864750) },
+  { U64x(a70c3c40,a64e6c51), U64x(999090b6,5f67d924) },
+  { U64x(d0cf4b50,cfe20765), U64x(fff4b4e3,f741cf6d) },
+  { U64x(82818f12,81ed449f), U64x(bff8f10e,7a8921a4) },
+  { U64x(a321f2d7,226895c7), U64x(aff72d52,192b6a0d) },
+  { U64x(cbea6f8c,eb02bb39), U64x(9bf4f8a6,9f764490) },
+  { U64x(fee50b70,25c36a08), U64x(02f236d0,4753d5b4) },
+  { U64x(9f4f2726,179a2245), U64x(01d76242,2c946590) },
+  { U64x(c722f0ef,9d80aad6), U64x(424d3ad2,b7b97ef5) },
+  { U64x(f8ebad2b,84e0d58b), U64x(d2e08987,65a7deb2) },
+  { U64x(9b934c3b,330c8577), U64x(63cc55f4,9f88eb2f) },
+  { U64x(c2781f49,ffcfa6d5), U64x(3cbf6b71,c76b25fb) },
+  { U64x(f316271c,7fc3908a), U64x(8bef464e,3945ef7a) },
+  { U64x(97edd871,cfda3a56), U64x(97758bf0,e3cbb5ac) },
+  { U64x(bde94e8e,43d0c8ec), U64x(3d52eeed,1cbea317) },
+  { U64x(ed63a231,d4c4fb27), U64x(4ca7aaa8,63ee4bdd) },
+  { U64x(945e455f,24fb1cf8), U64x(8fe8caa9,3e74ef6a) },
+  { U64x(b975d6b6,ee39e436), U64x(b3e2fd53,8e122b44) },
+  { U64x(e7d34c64,a9c85d44), U64x(60dbbca8,7196b616) },
+  { U64x(90e40fbe,ea1d3a4a), U64x(bc8955e9,46fe31cd) },
+  { U64x(b51d13ae,a4a488dd), U64x(6babab63,98bdbe41) },
+  { U64x(e264589a,4dcdab14), U64x(c696963c,7eed2dd1) },
+  { U64x(8d7eb760,70a08aec), U64x(fc1e1de5,cf543ca2) },
+  { U64x(b0de6538,8cc8ada8), U64x(3b25a55f,43294bcb) },
+  { U64x(dd15fe86,affad912), U64x(49ef0eb7,13f39ebe) },
+  { U64x(8a2dbf14,2dfcc7ab), U64x(6e356932,6c784337) },
+  { U64x(acb92ed9,397bf996), U64x(49c2c37f,07965404) },
+  { U64x(d7e77a8f,87daf7fb), U64x(dc33745e,c97be906) },
+  { U64x(86f0ac99,b4e8dafd), U64x(69a028bb,3ded71a3) },
+  { U64x(a8acd7c0,222311bc), U64x(c40832ea,0d68ce0c) },
+  { U64x(d2d80db0,2aabd62b), U64x(f50a3fa4,90c30190) },
+  { U64x(83c7088e,1aab65db), U64x(792667c6,da79e0fa) },
+  { U64x(a4b8cab1,a1563f52), U64x(577001b8,91185938) },
+  { U64x(cde6fd5e,09abcf26), U64x(ed4c0226,b55e6f86) },
+  { U64x(80b05e5a,c60b6178), U64x(544f8158,315b05b4) },
+  { U64x(a0dc75f1,778e39d6), U64x(696361ae,3db1c721) },
+  { U64x(c913936d,d571c84c), U64x(03bc3a19,cd1e38e9) },
+  { U64x(fb587849,4ace3a5f), U64x(04ab48a0,4065c723) },
+  { U64x(9d174b2d,cec0e47b), U64x(62eb0d64,283f9c76) },
+  { U64x(c45d1df9,42711d9a), U64x(3ba5d0bd,324f8394) },
+  { U64x(f5746577,930d6500), U64x(ca8f44ec,7ee36479) },
+  { U64x(9968bf6a,bbe85f20), U64x(7e998b13,cf4e1ecb) },
+  { U64x(bfc2ef45,6ae276e8), U64x(9e3fedd8,c321a67e) },
+  { U64x(efb3ab16,c59b14a2), U64x(c5cfe94e,f3ea101e) }
+};
+
+/* 64 x 64 -> 128 bit multiplication. Returns high part, stores low part. */
+static LJ_AINLINE uint64_t strscan_mul128(uint64_t a, uint64_t b, uint64_t *lo)
+{
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__SIZEOF_INT128__)
+  unsigned __int128 r = (unsigned __int128)a * b;
+  *lo = (uint64_t)r;
+  return (uint64_t)(r >> 64);
+#else
+  uint64_t al = (uint32_t)a, ah = a >> 32, bl = (uint32_t)b, bh = b >> 32;
+  uint64_t ll = al*bl, lh = al*bh, hl = ah*bl;
+  uint64_t mid = (ll >> 32) + (uint32_t)lh + (uint32_t)hl;
+  *lo = (mid << 32) | (uint32_t)ll;
+  return ah*bh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+}
+
+/* Try the fast path for a decimal number. Returns 0 if not applicable. */
+static int strscan_decfast(const uint8_t *p, TValue *o,
+			   int32_t ex10, int32_t neg, uint32_t dig)
+{
+  const uint64_t *pw;
+  uint64_t w = 0, hi, lo, m;
+  int32_t lz, up, e2;
+  if (dig == 0 || dig > 19 || ex10 < STRSCAN_P5MIN || ex10 > STRSCAN_P5MAX)
+    return 0;
+  for ( ; dig > 0; p++)
+    if (*p != '.') w = w * 10 + (*p & 15), dig--;
+  if (w == 0) return 0;
+#if (defined(__GNUC__) || defined(__clang__)) && LJ_64
+  lz = (int32_t)__builtin_clzll(w);
+#else
+  lz = 63 - ((w>>32) ? 32+(int32_t)lj_fls((uint32_t)(w>>32)) :
+		       (int32_t)lj_fls((uint32_t)w));
+#endif
+  w <<= lz;
+  pw = strscan_pow5[ex10 - STRSCAN_P5MIN];
+  hi = strscan_mul128(w, pw[0], &lo);
+  if ((hi & 0x1ff) == 0x1ff) {  /* Need more precision? */
+    uint64_t lo2, hi2 = strscan_mul128(w, pw[1], &lo2);
+    lo += hi2; if (lo < hi2) hi++;
+  }
+  if (lo == ~(uint64_t)0 && (ex10 < -27 || ex10 > 55))
+    return 0;  /* Inexact. Leave it to the exact parser. */
+  up = (int32_t)(hi >> 63);
+  m = hi >> (up + 9);
+  e2 = (((152170 + 65536) * ex10) >> 16) + 63 + up - lz + 1023;
+  lj_assertX(e2 > 0 && e2 < 0x7fe, "bad exponent");
+  /* Round to nearest even: detect exact halfway cases. */
+  if (lo <= 1 && ex10 >= -4 && ex10 <= 23 && (m & 3) == 1 &&
+      (m << (up + 9)) == hi)
+    m &= ~(uint64_t)1;
+  m += (m & 1); m >>= 1;
+  if (m >= ((uint64_t)2 << 52)) m = (uint64_t)1 << 52, e2++;
+  o->u64 = (m & ~((uint64_t)1 << 52)) + ((uint64_t)e2 << 52) +
+	   ((uint64_t)neg << 63);
+  return 1;
+}
+
 /* Final conversion to double. */
 static void strscan_double(uint64_t x, TValue *o, int32_t ex2, int32_t neg)
 {
@@ -371,7 +637,10 @@ static StrScanFmt strscan_bin(const uint8_t *p, TValue *o,
   return fmt;
 }
 
-/* Scan string containing a number. Returns format. Returns value in o. */
+/* Scan string containing a number. Returns format. Returns value in o.
+** The char at p[len] is inspected, but must not continue the number.
+** A terminating NUL or the char following a lexed literal satisfy this.
+*/
 StrScanFmt lj_strscan_scan(const uint8_t *p, MSize len, TValue *o,
 			   uint32_t opt)
 {
@@ -472,7 +741,7 @@ StrScanFmt lj_strscan_scan(const uint8_t *p, MSize len, TValue *o,
     }
 
     /* Parse suffix. */
-    if (*p) {
+    if (p < pe) {
       /* I (IMAG), U (U32), LL (I64), ULL/LLU (U64), L (long), UL/LU (ulong). */
       /* NYI: f (float). Not needed until cp_number() handles non-integers. */
       if (casecmp(*p, 'i')) {
@@ -492,8 +761,7 @@ StrScanFmt lj_strscan_scan(const uint8_t *p, MSize len, TValue *o,
 	    (fmt >= STRSCAN_I64 && !(opt & STRSCAN_OPT_LL)))
 	  return STRSCAN_ERROR;
       }
-      while (lj_char_isspace(*p)) p++;
-      if (*p) return STRSCAN_ERROR;
+      while (p < pe && lj_char_isspace(*p)) p++;
     }
     if (p < pe) return STRSCAN_ERROR;
 
@@ -519,7 +787,7 @@ StrScanFmt lj_strscan_scan(const uint8_t *p, MSize len, TValue *o,
       fmt = strscan_hex(sp, o, fmt, opt, ex, neg, dig);
     else if (base == 2)
       fmt = strscan_bin(sp, o, fmt, opt, ex, neg, dig);
-    else
+    else if (!(fmt == STRSCAN_NUM && strscan_decfast(sp, o, ex, neg, dig)))
       fmt = strscan_dec(sp, o, fmt, opt, ex, neg, dig);
 
     /* Try to convert number to integer, if requested. */
@@ -12,7 +12,10 @@
 #include "lj_obj.h"
 #include "lj_gc.h"
 #include "lj_err.h"
+#include "lj_buf.h"
+#include "lj_str.h"
 #include "lj_tab.h"
+#include "lj_bcdump.h"
 
 /* -- Object hashing ------------------------------------------------------ */
 
@@ -42,7 +45,7 @@ static LJ_AINLINE void newhpart(lua_State *L, GCtab *t, uint32_t hbits)
   if (hbits > LJ_MAX_HBITS)
     lj_err_msg(L, LJ_ERR_TABOV);
   hsize = 1u << hbits;
-  node = lj_mem_newvec(L, hsize, Node);
+  node = (Node *)lj_mem_new(L, (GCSize)sizehpart(t, hsize));
   setmref(t->node, node);
   setfreetop(t, node, &node[hsize]);
   t->hmask = hsize-1;
@@ -66,6 +69,9 @@ static LJ_AINLINE void clearhpart(GCtab *t)
     setnilV(&n->key);
     setnilV(&n->val);
   }
+#if LJ_HASTABORD
+  if (tab_isord(t)) tab_ordcount(t) = 0;
+#endif
 }
 
 /* Clear array part of table. */
@@ -97,6 +103,9 @@ static GCtab *newtab(lua_State *L, uint32_t asize, uint32_t hbits)
     setmref(t->node, nilnode);
 #if LJ_GC64
     setmref(t->freetop, nilnode);
+#endif
+#if LJ_HASTABORD
+    t->ord = 0;
 #endif
   } else {  /* Otherwise separately allocate the array part. */
     Node *nilnode;
@@ -112,6 +121,9 @@ static GCtab *newtab(lua_State *L, uint32_t asize, uint32_t hbits)
     setmref(t->node, nilnode);
 #if LJ_GC64
     setmref(t->freetop, nilnode);
+#endif
+#if LJ_HASTABORD
+    t->ord = 0;
 #endif
     if (asize > 0) {
       if (asize > LJ_MAX_ASIZE)
@@ -160,15 +172,10 @@ GCtab * LJ_FASTCALL lj_tab_new1(lua_State *L, uint32_t ahsize)
 }
 #endif
 
-/* Duplicate a table. */
-GCtab * LJ_FASTCALL lj_tab_dup(lua_State *L, const GCtab *kt)
+/* Copy the array and hash part of a table with the same sizes. */
+static void copytab(lua_State *L, GCtab *t, const GCtab *kt)
 {
-  GCtab *t;
   uint32_t asize, hmask;
-  t = newtab(L, kt->asize, kt->hmask > 0 ? lj_fls(kt->hmask)+1 : 0);
-  lj_assertL(kt->asize == t->asize && kt->hmask == t->hmask,
-	     "mismatched size of table and template");
-  t->nomm = 0;  /* Keys with metamethod names may be present. */
   asize = kt->asize;
   if (asize > 0) {
     TValue *array = tvref(t->array);
@@ -186,8 +193,13 @@ GCtab * LJ_FASTCALL lj_tab_dup(lua_State *L, const GCtab *kt)
     uint32_t i;
     Node *node = noderef(t->node);
     Node *knode = noderef(kt->node);
+    Node *kfree = getfreetop(kt, knode);
     ptrdiff_t d = (char *)node - (char *)knode;
-    setfreetop(t, node, (Node *)((char *)getfreetop(kt, knode) + d));
+#if LJ_HASTABCOW
+    if (tab_iscow(kt))  /* Shared nodes: the free top is in the backing table. */
+      kfree = getfreetop(tab_cowref(kt), knode);
+#endif
+    setfreetop(t, node, (Node *)((char *)kfree + d));
     for (i = 0; i <= hmask; i++) {
       Node *kn = &knode[i];
       Node *n = &node[i];
@@ -197,12 +209,114 @@ GCtab * LJ_FASTCALL lj_tab_dup(lua_State *L, const GCtab *kt)
       setmref(n->next, next == NULL? next : (Node *)((char *)next + d));
     }
   }
+}
+
+/* Duplicate a table. */
+GCtab * LJ_FASTCALL lj_tab_dup(lua_State *L, const GCtab *kt)
+{
+  GCtab *t;
+  if (LJ_UNLIKELY(tab_islazy(kt)))  /* Fill in template on first use. */
+    lj_bcread_ktab(L, (GCtab *)kt);
+  t = newtab(L, kt->asize, kt->hmask > 0 ? lj_fls(kt->hmask)+1 : 0);
+  lj_assertL(kt->asize == t->asize && kt->hmask == t->hmask,
+	     "mismatched size of table and template");
+  t->nomm = 0;  /* Keys with metamethod names may be present. */
+  copytab(L, t, kt);
   return t;
 }
 
+#if LJ_HASTABCOW
+/* -- Copy-on-write tables ------------------------------------------------ */
+
+/*
+** A copy-on-write table has the LJ_TAB_COW flag set and shares the array
+** and hash part of a backing table, which is referenced by its freetop.
+** The backing table is not reachable from Lua code and is never written.
+** Every store into a table checks the flag (the VM does it together with
+** the write barrier) and unshares the table first.
+*/
+
+/* Minimum number of array and hash slots of a template worth sharing. */
+#define TAB_COW_MIN	64
+
+/* Move the storage of a template to a new backing table. */
+static GCtab *cow_backing(lua_State *L, GCtab *kt)
+{
+  GCtab *bt = newtab(L, 0, 0);
+  if (LJ_MAX_COLOSIZE != 0 && kt->colo > 0) {  /* Separate colocated array. */
+    setmref(bt->array, lj_mem_newvec(L, kt->asize, TValue));
+    memcpy(tvref(bt->array), tvref(kt->array), kt->asize*sizeof(TValue));
+    setmrefr(kt->array, bt->array);
+  } else {
+    setmrefr(bt->array, kt->array);
+  }
+  bt->asize = kt->asize;
+  bt->hmask = kt->hmask;
+  setmrefr(bt->node, kt->node);
+  setmrefr(bt->freetop, kt->freetop);
+  setmref(kt->freetop, bt);
+  kt->marked |= LJ_TAB_COW;
+  lj_gc_anybarriert(L, kt);
+  return bt;
+}
+
+/* Give a copy-on-write table a private copy of its storage, if needed. */
+void LJ_FASTCALL lj_tab_unshare(lua_State *L, GCtab *t)
+{
+  GCtab *ct;
+  Node *nilnode = &G(L)->nilnode;
+  if (!tab_iscow(t)) return;  /* Already private. */
+  /* Build the copy in a temporary table, which owns it in case of OOM. */
+  ct = newtab(L, 0, t->hmask > 0 ? lj_fls(t->hmask)+1 : 0);
+  if (t->asize > 0) {
+    setmref(ct->array, lj_mem_newvec(L, t->asize, TValue));
+    ct->asize = t->asize;
+  }
+  copytab(L, ct, t);
+  setmrefr(t->array, ct->array);
+  setmrefr(t->node, ct->node);
+  setmrefr(t->freetop, ct->freetop);
+  if (LJ_MAX_COLOSIZE != 0 && t->colo > 0)
+    t->colo = (int8_t)(t->colo | 0x80);  /* Mark as separated (colo < 0). */
+  t->marked &= (uint8_t)~LJ_TAB_COW;
+  /* Leave an empty table to the GC. */
+  setmref(ct->array, NULL);
+  ct->asize = 0;
+  ct->hmask = 0;
+  setmref(ct->node, nilnode);
+  setmref(ct->freetop, nilnode);
+  lj_gc_anybarriert(L, t);
+}
+#endif
+
+/* Duplicate a template table. Large ones may share their storage. */
+GCtab * LJ_FASTCALL lj_tab_dupcow(lua_State *L, GCtab *kt)
+{
+#if LJ_HASTABCOW
+  if ((G(L)->tabcow & TABCOW_ON)) {
+    if (LJ_UNLIKELY(tab_islazy(kt)))  /* Fill in template on first use. */
+      lj_bcread_ktab(L, kt);
+    if (kt->asize + kt->hmask >= TAB_COW_MIN) {
+      GCtab *bt = tab_iscow(kt) ? tab_cowref(kt) : cow_backing(L, kt);
+      GCtab *t = newtab(L, 0, 0);
+      t->nomm = 0;  /* Keys with metamethod names may be present. */
+      setmrefr(t->array, bt->array);
+      t->asize = bt->asize;
+      t->hmask = bt->hmask;
+      setmrefr(t->node, bt->node);
+      setmref(t->freetop, bt);
+      t->marked |= LJ_TAB_COW;
+      return t;
+    }
+  }
+#endif
+  return lj_tab_dup(L, kt);
+}
+
 /* Clear a table. */
 void LJ_FASTCALL lj_tab_clear(GCtab *t)
 {
+  lj_assertX(!tab_iscow(t), "clear of shared table");
   clearapart(t);
   if (t->hmask > 0) {
     Node *node = noderef(t->node);
@@ -214,10 +328,12 @@ void LJ_FASTCALL lj_tab_clear(GCtab *t)
 /* Free a table. */
 void LJ_FASTCALL lj_tab_free(global_State *g, GCtab *t)
 {
-  if (t->hmask > 0)
-    lj_mem_freevec(g, noderef(t->node), t->hmask+1, Node);
-  if (t->asize > 0 && LJ_MAX_COLOSIZE != 0 && t->colo <= 0)
-    lj_mem_freevec(g, tvref(t->array), t->asize, TValue);
+  if (!tab_iscow(t)) {  /* Shared storage is owned by the backing table. */
+    if (t->hmask > 0)
+      lj_mem_free(g, noderef(t->node), sizehpart(t, t->hmask+1));
+    if (t->asize > 0 && LJ_MAX_COLOSIZE != 0 && t->colo <= 0)
+      lj_mem_freevec(g, tvref(t->array), t->asize, TValue);
+  }
   if (LJ_MAX_COLOSIZE != 0 && t->colo)
     lj_mem_free(g, t, sizetabcolo((uint32_t)t->colo & 0x7f));
   else
@@ -229,9 +345,19 @@ void LJ_FASTCALL lj_tab_free(global_State *g, GCtab *t)
 /* Resize a table to fit the new array/hash part sizes. */
 void lj_tab_resize(lua_State *L, GCtab *t, uint32_t asize, uint32_t hbits)
 {
-  Node *oldnode = noderef(t->node);
-  uint32_t oldasize = t->asize;
-  uint32_t oldhmask = t->hmask;
+  Node *oldnode;
+  uint32_t oldasize, oldhmask;
+  if (LJ_UNLIKELY(tab_iscow(t))) {
+    lj_tab_unshare(L, t);
+    if (asize == t->asize &&
+	hbits == (t->hmask > 0 ? (uint32_t)lj_fls(t->hmask)+1 : 0))
+      return;  /* Only needed a private copy. */
+  }
+  oldnode = noderef(t->node);
+  oldasize = t->asize;
+  oldhmask = t->hmask;
+  if (tab_isord(t) && !hbits)
+    hbits = 1;  /* Ordered tables always keep a hash part. */
   if (asize > oldasize) {  /* Array part grows? */
     TValue *array;
     uint32_t i;
@@ -280,13 +406,23 @@ void lj_tab_resize(lua_State *L, GCtab *t, uint32_t asize, uint32_t hbits)
   if (oldhmask > 0) {  /* Reinsert pairs from old hash part. */
     global_State *g;
     uint32_t i;
+#if LJ_HASTABORD
+    if (tab_isord(t)) {  /* Reinsert in insertion order. */
+      uint32_t *ord = (uint32_t *)(oldnode + oldhmask+1);
+      for (i = 0; i < ord[0]; i++) {
+	Node *n = &oldnode[ord[1+i]];
+	if (!tvisnil(&n->val))
+	  copyTV(L, lj_tab_set(L, t, &n->key), &n->val);
+      }
+    } else
+#endif
     for (i = 0; i <= oldhmask; i++) {
       Node *n = &oldnode[i];
       if (!tvisnil(&n->val))
 	copyTV(L, lj_tab_set(L, t, &n->key), &n->val);
     }
     g = G(L);
-    lj_mem_freevec(g, oldnode, oldhmask+1, Node);
+    lj_mem_free(g, oldnode, sizehpart(t, oldhmask+1));
   }
 }
 
@@ -367,11 +503,76 @@ static void rehashtab(lua_State *L, GCtab *t, cTValue *ek)
   lj_tab_resize(L, t, asize, hsize2hbits(total));
 }
 
-#if LJ_HASFFI
+/* Resize a table to fit its live keys. Drops deleted keys, too. */
 void lj_tab_rehash(lua_State *L, GCtab *t)
 {
   rehashtab(L, t, niltv(L));
 }
+
+#if LJ_HASTABORD
+/* Order of existing keys: numbers, strings, false, true, then the rest. */
+static int order_lt(cTValue *a, cTValue *b)
+{
+  int ra = tvisnum(a) ? 0 : tvisstr(a) ? 1 : tvisbool(a) ? 2 : 3;
+  int rb = tvisnum(b) ? 0 : tvisstr(b) ? 1 : tvisbool(b) ? 2 : 3;
+  if (ra != rb) return ra < rb;
+  if (ra == 0) return numV(a) < numV(b);
+  if (ra == 1) return lj_str_cmp(strV(a), strV(b)) < 0;
+  return ra == 2 && tvisfalse(a) && tvistrue(b);
+}
+
+/* Stable bottom-up merge sort of n node indexes. Returns a or b. */
+static uint32_t *order_sort(Node *node, uint32_t *a, uint32_t *b, uint32_t n)
+{
+  uint32_t w, i;
+  for (w = 1; w < n; w += w) {
+    uint32_t *c;
+    for (i = 0; i < n; i += w+w) {
+      uint32_t l = i, m = i+w < n ? i+w : n, r = m, e = m+w < n ? m+w : n;
+      uint32_t k = i;
+      while (l < m && r < e)
+	b[k++] = order_lt(&node[a[r]].key, &node[a[l]].key) ? a[r++] : a[l++];
+      while (l < m) b[k++] = a[l++];
+      while (r < e) b[k++] = a[r++];
+    }
+    c = a; a = b; b = c;
+  }
+  return a;
+}
+
+/* Make the hash part of a table keep the insertion order of its keys.
+** The keys already in the hash part get a defined order, too, since the
+** node order depends on the string hash seed and object addresses.
+*/
+void lj_tab_order(lua_State *L, GCtab *t)
+{
+  Node *oldnode;
+  uint32_t oldhmask, i, n = 0, *idx = NULL;
+  if (tab_isord(t)) return;
+  lj_tab_checkcow(L, t);
+  oldnode = noderef(t->node);
+  oldhmask = t->hmask;
+  if (oldhmask > 0) {  /* Sort the live keys before detaching anything. */
+    idx = (uint32_t *)lj_buf_tmp(L, 2*(oldhmask+1)*(MSize)sizeof(uint32_t));
+    for (i = 0; i <= oldhmask; i++)
+      if (!tvisnil(&oldnode[i].val))
+	idx[n++] = i;
+    idx = order_sort(oldnode, idx, idx + oldhmask+1, n);
+  }
+  /* Detach the old hash part, so the new one starts empty. */
+  setmref(t->node, &G(L)->nilnode);
+  setmref(t->freetop, &G(L)->nilnode);
+  t->hmask = 0;
+  t->ord = 1;
+  lj_tab_resize(L, t, t->asize, oldhmask > 0 ? lj_fls(oldhmask)+1 : 1);
+  if (oldhmask > 0) {
+    for (i = 0; i < n; i++) {
+      Node *nn = &oldnode[idx[i]];
+      copyTV(L, lj_tab_set(L, t, &nn->key), &nn->val);
+    }
+    lj_mem_freevec(G(L), oldnode, oldhmask+1, Node);
+  }
+}
 #endif
 
 void lj_tab_reasize(lua_State *L, GCtab *t, uint32_t nasize)
@@ -441,25 +642,55 @@ cTValue *lj_tab_get(lua_State *L, GCtab *t, cTValue *key)
 /* Insert new key. Use Brent's variation to optimize the chain length. */
 TValue *lj_tab_newkey(lua_State *L, GCtab *t, cTValue *key)
 {
-  Node *n = hashkey(t, key);
-  if (!tvisnil(&n->val) || t->hmask == 0) {
+  Node *n;
+  lj_tab_checkcow(L, t);
+  /* A free top at the bottom of a large hash part means it is full or the
+  ** GC found it mostly empty. Either way rehash now, see gc_shrinktab().
+  */
+  if (LJ_UNLIKELY(t->hmask >= LJ_TAB_SHRINKMIN-1) &&
+      getfreetop(t, noderef(t->node)) == noderef(t->node)) {
+    rehashtab(L, t, key);
+    return lj_tab_set(L, t, key);
+  }
+  n = hashkey(t, key);
+  /* Ordered tables never reuse the node of a deleted key before a rehash. */
+  if (!tvisnil(&n->val) || t->hmask == 0 ||
+      (tab_isord(t) && !tvisnil(&n->key))) {
     Node *nodebase = noderef(t->node);
-    Node *collide, *freenode = getfreetop(t, nodebase);
-    lj_assertL(freenode >= nodebase && freenode <= nodebase+t->hmask+1,
-	       "bad freenode");
-    do {
-      if (freenode == nodebase) {  /* No free node found? */
-	rehashtab(L, t, key);  /* Rehash table. */
-	return lj_tab_set(L, t, key);  /* Retry key insertion. */
-      }
-    } while (!tvisnil(&(--freenode)->key));
-    setfreetop(t, nodebase, freenode);
+    Node *collide, *freenode;
+    /* Prefer a free neighbour of the main node, so chains stay within one
+    ** or two cache lines. Free nodes always lie below the free top.
+    */
+    if (n < nodebase+t->hmask && tvisnil(&n[1].key)) {
+      freenode = n+1;
+    } else if (n > nodebase && tvisnil(&n[-1].key)) {
+      freenode = n-1;
+    } else {
+      freenode = getfreetop(t, nodebase);
+      lj_assertL(freenode >= nodebase && freenode <= nodebase+t->hmask+1,
+		 "bad freenode");
+      do {
+	if (freenode == nodebase) {  /* No free node found? */
+	  rehashtab(L, t, key);  /* Rehash table. */
+	  return lj_tab_set(L, t, key);  /* Retry key insertion. */
+	}
+      } while (!tvisnil(&(--freenode)->key));
+      setfreetop(t, nodebase, freenode);
+    }
     lj_assertL(freenode != &G(L)->nilnode, "store to fallback hash");
-    collide = hashkey(t, &n->key);
-    if (collide != n) {  /* Colliding node not the main node? */
+    /* Keep the deleted key of an ordered table, it may be unchained. */
+    if (!tvisnil(&n->val) &&
+	(collide = hashkey(t, &n->key)) != n) {  /* Colliding node not main? */
       while (noderef(collide->next) != n)  /* Find predecessor. */
 	collide = nextnode(collide);
       setmref(collide->next, freenode);  /* Relink chain. */
+#if LJ_HASTABORD
+      if (tab_isord(t)) {  /* The colliding key keeps its slot. */
+	uint32_t s = tab_ordslot(t, n - nodebase);
+	tab_ordnode(t, s) = (uint32_t)(freenode - nodebase);
+	tab_ordslot(t, freenode - nodebase) = s;
+      }
+#endif
       /* Copy colliding node into free node and free main node. */
       freenode->val = n->val;
       freenode->key = n->key;
@@ -509,6 +740,13 @@ TValue *lj_tab_newkey(lua_State *L, GCtab *t, cTValue *key)
   n->key.u64 = key->u64;
   if (LJ_UNLIKELY(tvismzero(&n->key)))
     n->key.u64 = 0;
+#if LJ_HASTABORD
+  if (tab_isord(t)) {  /* Append a slot for the new key. */
+    uint32_t s = tab_ordcount(t)++, i = (uint32_t)(n - noderef(t->node));
+    tab_ordnode(t, s) = i;
+    tab_ordslot(t, i) = s;
+  }
+#endif
   lj_gc_anybarriert(L, t);
   lj_assertL(tvisnil(&n->val), "new hash slot is not empty");
   return &n->val;
@@ -518,6 +756,11 @@ TValue *lj_tab_setinth(lua_State *L, GCtab *t, int32_t key)
 {
   TValue k;
   Node *n;
+  if (LJ_UNLIKELY(tab_iscow(t))) {
+    lj_tab_unshare(L, t);
+    if (inarray(t, key))
+      return arrayslot(t, key);
+  }
   k.n = (lua_Number)key;
   n = hashnum(t, &k);
   do {
@@ -530,7 +773,9 @@ TValue *lj_tab_setinth(lua_State *L, GCtab *t, int32_t key)
 TValue *lj_tab_setstr(lua_State *L, GCtab *t, const GCstr *key)
 {
   TValue k;
-  Node *n = hashstr(t, key);
+  Node *n;
+  lj_tab_checkcow(L, t);
+  n = hashstr(t, key);
   do {
     if (tvisstr(&n->key) && strV(&n->key) == key)
       return &n->val;
@@ -543,6 +788,7 @@ TValue *lj_tab_set(lua_State *L, GCtab *t, cTValue *key)
 {
   Node *n;
   t->nomm = 0;  /* Invalidate negative metamethod cache. */
+  lj_tab_checkcow(L, t);
   if (tvisstr(key)) {
     return lj_tab_setstr(L, t, strV(key));
   } else if (tvisint(key)) {
@@ -566,6 +812,41 @@ TValue *lj_tab_set(lua_State *L, GCtab *t, cTValue *key)
   return lj_tab_newkey(L, t, key);
 }
 
+/* Raw move of dst[t..t+e-f] = src[f..e]. Caller checks the index ranges. */
+void lj_tab_move(lua_State *L, GCtab *src, int32_t f, int32_t e, int32_t t,
+		 GCtab *dst)
+{
+  int32_t i, n;
+  if (e < f) return;
+  n = e - f + 1;
+  lj_tab_checkcow(L, dst);
+  if (t > 0 && (uint32_t)t <= (dst->asize ? dst->asize : 1) &&
+      (uint32_t)(t+n-1) >= dst->asize && (uint32_t)(t+n-1) < LJ_MAX_ASIZE) {
+    /* Grow the array part first, if the destination continues it. */
+    uint32_t need = (uint32_t)(t+n-1), grow = dst->asize + (dst->asize >> 1);
+    lj_tab_reasize(L, dst, need < grow && grow < LJ_MAX_ASIZE ? grow : need);
+  }
+  if (f >= 0 && (uint32_t)e < src->asize &&
+      t >= 0 && (uint32_t)(t+n-1) < dst->asize) {  /* Both in array parts. */
+    memmove(arrayslot(dst, t), arrayslot(src, f), (size_t)n*sizeof(TValue));
+  } else {
+    int32_t d = 1;
+    if (src == dst && t > f) { d = -1; f = e; t += n-1; }  /* Overlap. */
+    for (i = 0; i < n; i++, f += d, t += d) {
+      cTValue *o = lj_tab_getint(src, f);
+      if (o && !tvisnil(o)) {
+	TValue tmp;
+	copyTV(L, &tmp, o);  /* The set may invalidate the get pointer. */
+	copyTV(L, lj_tab_setint(L, dst, t), &tmp);
+      } else {
+	TValue *tv = (TValue *)lj_tab_getint(dst, t);
+	if (tv) setnilV(tv);
+      }
+    }
+  }
+  lj_gc_anybarriert(L, dst);
+}
+
 /* -- Table traversal ----------------------------------------------------- */
 
 /* Table traversal indexes:
@@ -573,6 +854,8 @@ TValue *lj_tab_set(lua_State *L, GCtab *t, cTValue *key)
 ** Array key index: [0 .. t->asize-1]
 ** Hash key index:  [t->asize .. t->asize+t->hmask]
 ** Invalid key:     ~0
+**
+** The hash key index of an ordered table counts slots instead of nodes.
 */
 
 /* Get the successor traversal index of a key. */
@@ -594,8 +877,13 @@ uint32_t LJ_FASTCALL lj_tab_keyindex(GCtab *t, cTValue *key)
   if (!tvisnil(key)) {
     Node *n = hashkey(t, key);
     do {
-      if (lj_obj_equal(&n->key, key))
+      if (lj_obj_equal(&n->key, key)) {
+#if LJ_HASTABORD
+	if (tab_isord(t))
+	  return t->asize + tab_ordslot(t, n - noderef(t->node)) + 1;
+#endif
 	return t->asize + (uint32_t)((n+1) - noderef(t->node));
+      }
     } while ((n = nextnode(n)));
     if (key->u32.hi == LJ_KEYINDEX)  /* Despecialized ITERN while running. */
       return key->u32.lo;
@@ -618,6 +906,19 @@ int lj_tab_next(GCtab *t, cTValue *key, TValue *o)
     }
   }
   idx -= t->asize;
+#if LJ_HASTABORD
+  if (tab_isord(t)) {  /* Traverse the hash part in insertion order. */
+    for (; idx < tab_ordcount(t); idx++) {
+      Node *n = &noderef(t->node)[tab_ordnode(t, idx)];
+      if (!tvisnil(&n->val)) {
+	o[0] = n->key;
+	o[1] = n->val;
+	return 1;
+      }
+    }
+    return (int32_t)idx < 0 ? -1 : 0;
+  }
+#endif
   /* Then traverse the hash part. */
   for (; idx <= t->hmask; idx++) {
     Node *n = &noderef(t->node)[idx];
@@ -52,16 +52,45 @@ static LJ_AINLINE Node *hashmask(const GCtab *t, uint32_t hash)
 
 #define hsize2hbits(s)	((s) ? ((s)==1 ? 1 : 1+lj_fls((uint32_t)((s)-1))) : 0)
 
+/* Copy-on-write TDUP mode flags for g->tabcow (see LUAJIT_MODE_TABCOW). */
+#define TABCOW_ON	1	/* TDUP shares the storage of large templates. */
+#define TABCOW_USED	2	/* Shared tables may exist. Never reset. */
+
+/* Min. hash part size the GC shrinks (see LUAJIT_MODE_TABSHRINK). */
+#define LJ_TAB_SHRINKMIN	1024
+
+#if LJ_HASTABORD
+/* The nodes of an ordered hash part are followed by its insertion order:
+** the number of used slots, the node index of each slot and the slot of
+** each node. A node gets its slot when a key is first stored in it.
+*/
+#define tab_ordref(t)		((uint32_t *)(noderef((t)->node) + (t)->hmask+1))
+#define tab_ordcount(t)		(tab_ordref((t))[0])
+#define tab_ordnode(t, s)	(tab_ordref((t))[1+(s)])
+#define tab_ordslot(t, i)	(tab_ordref((t))[2+(t)->hmask+(i)])
+#define sizehpart(t, hsize) \
+  ((hsize)*sizeof(Node) + (tab_isord((t)) ? (2*(hsize)+1)*sizeof(uint32_t) : 0))
+#else
+#define sizehpart(t, hsize)	((hsize)*sizeof(Node))
+#endif
+
 LJ_FUNCA GCtab *lj_tab_new(lua_State *L, uint32_t asize, uint32_t hbits);
 LJ_FUNC GCtab *lj_tab_new_ah(lua_State *L, int32_t a, int32_t h);
 #if LJ_HASJIT
 LJ_FUNC GCtab * LJ_FASTCALL lj_tab_new1(lua_State *L, uint32_t ahsize);
 #endif
 LJ_FUNCA GCtab * LJ_FASTCALL lj_tab_dup(lua_State *L, const GCtab *kt);
+LJ_FUNCA GCtab * LJ_FASTCALL lj_tab_dupcow(lua_State *L, GCtab *kt);
+#if LJ_HASTABCOW
+LJ_FUNC void LJ_FASTCALL lj_tab_unshare(lua_State *L, GCtab *t);
+#else
+#define lj_tab_unshare(L, t)	UNUSED(t)
+#endif
 LJ_FUNC void LJ_FASTCALL lj_tab_clear(GCtab *t);
 LJ_FUNC void LJ_FASTCALL lj_tab_free(global_State *g, GCtab *t);
-#if LJ_HASFFI
 LJ_FUNC void lj_tab_rehash(lua_State *L, GCtab *t);
+#if LJ_HASTABORD
+LJ_FUNC void lj_tab_order(lua_State *L, GCtab *t);
 #endif
 LJ_FUNC void lj_tab_resize(lua_State *L, GCtab *t, uint32_t asize, uint32_t hbits);
 LJ_FUNCA void lj_tab_reasize(lua_State *L, GCtab *t, uint32_t nasize);
@@ -72,19 +101,26 @@ LJ_FUNCA cTValue * LJ_FASTCALL lj_tab_getinth(GCtab *t, int32_t key);
 LJ_FUNC cTValue *lj_tab_getstr(GCtab *t, const GCstr *key);
 LJ_FUNCA cTValue *lj_tab_get(lua_State *L, GCtab *t, cTValue *key);
 
+/* Give a copy-on-write table a private copy before writing to it. */
+#define lj_tab_checkcow(L, t) \
+  { if (LJ_UNLIKELY(tab_iscow((t)))) lj_tab_unshare(L, (t)); }
+
 /* Caveat: all setters require a write barrier for the stored value. */
 
 LJ_FUNCA TValue *lj_tab_newkey(lua_State *L, GCtab *t, cTValue *key);
 LJ_FUNCA TValue *lj_tab_setinth(lua_State *L, GCtab *t, int32_t key);
 LJ_FUNC TValue *lj_tab_setstr(lua_State *L, GCtab *t, const GCstr *key);
 LJ_FUNC TValue *lj_tab_set(lua_State *L, GCtab *t, cTValue *key);
+LJ_FUNC void lj_tab_move(lua_State *L, GCtab *src, int32_t f, int32_t e,
+			 int32_t t, GCtab *dst);
 
 #define inarray(t, key)		((MSize)(key) < (MSize)(t)->asize)
 #define arrayslot(t, i)		(&tvref((t)->array)[(i)])
 #define lj_tab_getint(t, key) \
   (inarray((t), (key)) ? arrayslot((t), (key)) : lj_tab_getinth((t), (key)))
 #define lj_tab_setint(L, t, key) \
-  (inarray((t), (key)) ? arrayslot((t), (key)) : lj_tab_setinth(L, (t), (key)))
+  (inarray((t), (key)) && !tab_iscow((t)) ? arrayslot((t), (key)) : \
+   lj_tab_setinth(L, (t), (key)))
 
 LJ_FUNC uint32_t LJ_FASTCALL lj_tab_keyindex(GCtab *t, cTValue *key);
 LJ_FUNCA int lj_tab_next(GCtab *t, cTValue *key, TValue *o);
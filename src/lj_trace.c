@@ -938,7 +938,7 @@ int LJ_FASTCALL lj_trace_exit(jit_State *J, void *exptr)
     return (int)((BCReg)(L->top - L->base) - bc_a(*pc) - bc_c(*pc) - LJ_FR2);
   case BC_RETM:
     return (int)((BCReg)(L->top - L->base) + 1 - bc_a(*pc) - bc_d(*pc));
-  case BC_TSETM:
+  case BC_TSETM: case BC_TSTML: case BC_TSETMR:
     return (int)((BCReg)(L->top - L->base) + 1 - bc_a(*pc));
   default:
     if (bc_op(*pc) >= BC_FUNCF)
@@ -228,6 +228,8 @@ LUA_API int  (lua_status) (lua_State *L);
 #define LUA_GCSETPAUSE		6
 #define LUA_GCSETSTEPMUL	7
 #define LUA_GCISRUNNING		9
+#define LUA_GCSETLOADLIMIT	10
+#define LUA_GCLOADSTATS		11
 
 LUA_API int (lua_gc) (lua_State *L, int what, int data);
 
@@ -356,6 +358,10 @@ LUA_API lua_Integer lua_tointegerx (lua_State *L, int idx, int *isnum);
 /* From Lua 5.3. */
 LUA_API int lua_isyieldable (lua_State *L);
 
+/* Bulk construction of arrays. */
+LUA_API void lua_pushnumberarray (lua_State *L, const lua_Number *a, int n);
+LUA_API void lua_pushstringarray (lua_State *L, const char *const *a, int n);
+
 
 struct lua_Debug {
   int event;
@@ -51,6 +51,11 @@ enum {
 
   LUAJIT_MODE_WRAPCFUNC = 0x10,	/* Set wrapper mode for C function calls. */
 
+  LUAJIT_MODE_NUMFMT,		/* Shortest round-trip number to string. */
+  LUAJIT_MODE_TABCOW,		/* Copy-on-write duplication of templates. */
+  LUAJIT_MODE_CTORMULTI,	/* Expand all calls in table constructors. */
+  LUAJIT_MODE_TABSHRINK,	/* GC shrinks mostly empty hash parts. */
+
   LUAJIT_MODE_MAX
 };
 